@@ -0,0 +1,108 @@
+#include <algorithm>
+#include <math.h>
+#include <stdio.h>
+
+#include "harness.h"
+
+using namespace std;
+
+BenchmarkOptions::BenchmarkOptions()
+    : warmupSeconds(0.1), minSampleSeconds(0.01), minSeconds(0.5), minSamples(10), maxSamples(1000)
+{
+}
+
+BenchmarkRunner::BenchmarkRunner(const string& filter)
+    : filter(filter)
+{
+}
+
+bool BenchmarkRunner::enabled(const string& name)
+{
+    return filter.empty() || name.find(filter) != string::npos;
+}
+
+double BenchmarkRunner::now()
+{
+    return chrono::duration<double>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void BenchmarkRunner::addResult(const string& name, double itemsPerIteration, int64_t iterations,
+                                vector<double>& samples, const perfcounters::Values& counters)
+{
+    BenchmarkResult result;
+    result.name = name;
+    result.samples = (int)samples.size();
+    result.iterationsPerSample = iterations;
+    result.itemsPerIteration = itemsPerIteration;
+
+    sort(samples.begin(), samples.end());
+    double sum = 0.0;
+    for(size_t i=0; i<samples.size(); i++)
+    {
+        sum += samples[i];
+    }
+    result.mean = sum / samples.size();
+    double variance = 0.0;
+    for(size_t i=0; i<samples.size(); i++)
+    {
+        variance += (samples[i] - result.mean) * (samples[i] - result.mean);
+    }
+    result.stddev = (samples.size() > 1) ? sqrt(variance / (samples.size() - 1)) : 0.0;
+    result.median = samples[samples.size() / 2];
+    size_t rank = (size_t)ceil(0.95 * samples.size());
+    result.p95 = samples[(rank > 0) ? rank - 1 : 0];
+    result.min = samples.front();
+    result.max = samples.back();
+
+    double items = itemsPerIteration * iterations * samples.size();
+    result.instructionsPerCycle = perfcounters::instructionsPerCycle(counters);
+    result.cyclesPerItem = perfcounters::perElement(counters, perfcounters::CYCLES, items);
+    result.cacheMissesPerItem = perfcounters::perElement(counters, perfcounters::CACHE_MISSES, items);
+    result.branchMissesPerItem = perfcounters::perElement(counters, perfcounters::BRANCH_MISSES, items);
+    results.push_back(result);
+
+    double itemsPerSecond = itemsPerIteration * 1.0e9 / result.median;
+    printf("%-32s %12.1f ns  (median, +/- %5.1f%%, %3d samples x %lld)  %10.3f M items/s", name.c_str(),
+           result.median, 100.0 * result.stddev / result.mean, result.samples, (long long)iterations,
+           itemsPerSecond / 1.0e6);
+    if(result.instructionsPerCycle >= 0.0)
+    {
+        printf("  IPC %.2f", result.instructionsPerCycle);
+    }
+    if(result.cacheMissesPerItem >= 0.0 && result.branchMissesPerItem >= 0.0)
+    {
+        printf(", %.3f cache / %.3f branch misses per item", result.cacheMissesPerItem, result.branchMissesPerItem);
+    }
+    printf("\n");
+    fflush(stdout);
+}
+
+bool BenchmarkRunner::writeJSON(const string& filename)
+{
+    FILE* file = fopen(filename.c_str(), "w");
+    if(!file)
+    {
+        printf("Unable to write benchmark results: %s\n", filename.c_str());
+        return false;
+    }
+
+    fprintf(file, "{\n  \"benchmarks\": [");
+    for(size_t i=0; i<results.size(); i++)
+    {
+        const BenchmarkResult& result = results[i];
+        fprintf(file, "%s\n    {\"name\": \"%s\", \"samples\": %d, \"iterations_per_sample\": %lld, "
+                "\"mean_ns\": %.3f, \"median_ns\": %.3f, \"p95_ns\": %.3f, \"min_ns\": %.3f, \"max_ns\": %.3f, "
+                "\"stddev_ns\": %.3f, \"items_per_second\": %.1f, \"ipc\": %s, \"cycles_per_item\": %s, "
+                "\"cache_misses_per_item\": %s, \"branch_misses_per_item\": %s}",
+                (i > 0) ? "," : "", result.name.c_str(), result.samples, (long long)result.iterationsPerSample,
+                result.mean, result.median, result.p95, result.min, result.max, result.stddev,
+                result.itemsPerIteration * 1.0e9 / result.median,
+                perfcounters::counterJSON(result.instructionsPerCycle).c_str(),
+                perfcounters::counterJSON(result.cyclesPerItem).c_str(),
+                perfcounters::counterJSON(result.cacheMissesPerItem).c_str(),
+                perfcounters::counterJSON(result.branchMissesPerItem).c_str());
+    }
+    fprintf(file, "\n  ]\n}\n");
+    fclose(file);
+    return true;
+}
@@ -0,0 +1,136 @@
+#ifndef BENCH_HARNESS_H
+#define BENCH_HARNESS_H
+
+#include <chrono>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "perfcounters.h"
+
+// A minimal microbenchmark harness, so the kernels can be timed without any external library.
+//
+// Every benchmark is a function taking an iteration count. The runner first warms it up, then
+// picks an iteration count that makes each sample last at least minSampleSeconds, and keeps
+// taking samples until it has both minSamples of them and minSeconds of measurements (or
+// maxSamples). Statistics are over the per-iteration time of each sample.
+//
+// When hardware performance counters are available (see perfcounters.h) they are read around
+// every sample as well, and reported as IPC and cycles/misses per item.
+struct BenchmarkOptions
+{
+    BenchmarkOptions();
+
+    double warmupSeconds;
+    double minSampleSeconds;
+    double minSeconds;
+    int minSamples;
+    int maxSamples;
+};
+
+struct BenchmarkResult
+{
+    std::string name;
+    int samples;
+    int64_t iterationsPerSample;
+    double itemsPerIteration;
+
+    // Nanoseconds per iteration
+    double mean;
+    double median;
+    double p95;
+    double min;
+    double max;
+    double stddev;
+
+    // Hardware counters over all samples, -1 when unavailable
+    double instructionsPerCycle;
+    double cyclesPerItem;
+    double cacheMissesPerItem;
+    double branchMissesPerItem;
+};
+
+// Keeps the compiler from optimising away a computation whose result is otherwise unused
+template<typename T> inline void doNotOptimize(const T& value)
+{
+#if defined(__GNUC__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile const T* sink;
+    sink = &value;
+#endif
+}
+
+class BenchmarkRunner
+{
+public:
+    // Only benchmarks whose name contains filter are run (all of them if it's empty)
+    BenchmarkRunner(const std::string& filter);
+
+    bool enabled(const std::string& name);
+
+    // itemsPerIteration is used to report throughput, e.g. triangles per second
+    template<typename Function>
+    void run(const std::string& name, double itemsPerIteration, const BenchmarkOptions& options, Function function);
+
+    bool writeJSON(const std::string& filename);
+
+private:
+    static double now();
+    void addResult(const std::string& name, double itemsPerIteration, int64_t iterations,
+                   std::vector<double>& samples, const perfcounters::Values& counters);
+
+    std::string filter;
+    std::vector<BenchmarkResult> results;
+};
+
+template<typename Function>
+void BenchmarkRunner::run(const std::string& name, double itemsPerIteration, const BenchmarkOptions& options,
+                          Function function)
+{
+    if(!enabled(name))
+    {
+        return;
+    }
+
+    // Warm up caches, branch predictors and lazily initialised state, and measure roughly how
+    // long one iteration takes while at it
+    int64_t warmupIterations = 0;
+    double start = now();
+    double elapsed = 0.0;
+    do
+    {
+        function((int64_t)1);
+        warmupIterations++;
+        elapsed = now() - start;
+    } while(elapsed < options.warmupSeconds);
+
+    double iterationSeconds = elapsed / warmupIterations;
+    int64_t iterations = (int64_t)(options.minSampleSeconds / iterationSeconds) + 1;
+
+    std::vector<double> samples;
+    perfcounters::Values counters = {};
+    double measured = 0.0;
+    while((int)samples.size() < options.maxSamples &&
+          ((int)samples.size() < options.minSamples || measured < options.minSeconds))
+    {
+        perfcounters::Values before;
+        perfcounters::Values after;
+        bool counted = perfcounters::read(before);
+        double sampleStart = now();
+        function(iterations);
+        double sampleSeconds = now() - sampleStart;
+        if(counted && perfcounters::read(after))
+        {
+            for(int counter=0; counter<perfcounters::COUNTER_COUNT; counter++)
+            {
+                counters.counts[counter] += after.counts[counter] - before.counts[counter];
+            }
+        }
+        measured += sampleSeconds;
+        samples.push_back(sampleSeconds * 1.0e9 / iterations);
+    }
+    addResult(name, itemsPerIteration, iterations, samples, counters);
+}
+
+#endif
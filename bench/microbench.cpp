@@ -0,0 +1,413 @@
+#include <iostream>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "harness.h"
+#include "bcencoder.h"
+#include "geometry.h"
+#include "jobsystem.h"
+#include "scene.h"
+
+using namespace std;
+
+// Swallows the loader's progress output while it's being timed
+class NullBuffer : public streambuf
+{
+protected:
+    int overflow(int c)
+    {
+        return c;
+    }
+};
+
+// Writes a UV sphere with (about) the given number of triangles, laid out like a Blender export:
+// positions, then texture coordinates, then normals, then v/vt/vn faces
+static bool writeSyntheticOBJ(const string& filename, int triangleCount)
+{
+    FILE* file = fopen(filename.c_str(), "w");
+    if(!file)
+    {
+        printf("Unable to write %s\n", filename.c_str());
+        return false;
+    }
+
+    int rows = (int)sqrt(triangleCount / 4.0);
+    rows = (rows < 2) ? 2 : rows;
+    int columns = 2 * rows;
+    const double pi = 3.14159265358979323846;
+
+    fprintf(file, "# Synthetic UV sphere, %d triangles\n", 2 * rows * columns);
+    for(int row=0; row<=rows; row++)
+    {
+        for(int column=0; column<=columns; column++)
+        {
+            double theta = pi * row / rows;
+            double phi = 2.0 * pi * column / columns;
+            fprintf(file, "v %f %f %f\n", sin(theta) * cos(phi), cos(theta), sin(theta) * sin(phi));
+        }
+    }
+    for(int row=0; row<=rows; row++)
+    {
+        for(int column=0; column<=columns; column++)
+        {
+            fprintf(file, "vt %f %f\n", (double)column / columns, 1.0 - (double)row / rows);
+        }
+    }
+    for(int row=0; row<=rows; row++)
+    {
+        for(int column=0; column<=columns; column++)
+        {
+            double theta = pi * row / rows;
+            double phi = 2.0 * pi * column / columns;
+            fprintf(file, "vn %f %f %f\n", sin(theta) * cos(phi), cos(theta), sin(theta) * sin(phi));
+        }
+    }
+    for(int row=0; row<rows; row++)
+    {
+        for(int column=0; column<columns; column++)
+        {
+            // OBJ indices are 1-based
+            int a = row * (columns + 1) + column + 1;
+            int b = a + columns + 1;
+            fprintf(file, "f %d/%d/%d %d/%d/%d %d/%d/%d\n", a, a, a, b, b, b, a + 1, a + 1, a + 1);
+            fprintf(file, "f %d/%d/%d %d/%d/%d %d/%d/%d\n", a + 1, a + 1, a + 1, b, b, b, b + 1, b + 1, b + 1);
+        }
+    }
+    fclose(file);
+    return true;
+}
+
+static void benchmarkOBJLoad(BenchmarkRunner& runner, const string& name, const string& filename,
+                             double triangleCount, const BenchmarkOptions& options)
+{
+    runner.run(name, triangleCount, options, [&](int64_t iterations)
+    {
+        NullBuffer nullBuffer;
+        streambuf* previous = cout.rdbuf(&nullBuffer);
+        for(int64_t i=0; i<iterations; i++)
+        {
+            GeometryData geometry;
+            geometry.loadFromOBJFile(filename);
+            doNotOptimize(geometry.indexCount());
+        }
+        cout.rdbuf(previous);
+    });
+}
+
+static void benchmarkLoader(BenchmarkRunner& runner, const string& dataDirectory, const vector<int>& syntheticSizes)
+{
+    BenchmarkOptions options;
+    options.warmupSeconds = 0.0;
+    options.minSampleSeconds = 0.0;
+    options.minSeconds = 2.0;
+    options.minSamples = 5;
+    options.maxSamples = 50;
+    benchmarkOBJLoad(runner, "obj_load/sphere-fixed", dataDirectory + "/sphere-fixed.obj", 3072, options);
+
+    // The big meshes take seconds per load, so a few samples will have to do
+    options.minSeconds = 0.0;
+    options.minSamples = 3;
+    for(size_t i=0; i<syntheticSizes.size(); i++)
+    {
+        char name[64];
+        snprintf(name, sizeof(name), "obj_load/synthetic_%d", syntheticSizes[i]);
+        if(!runner.enabled(name))
+        {
+            continue;
+        }
+        char filename[64];
+        snprintf(filename, sizeof(filename), "synthetic_%d.obj", syntheticSizes[i]);
+        if(writeSyntheticOBJ(filename, syntheticSizes[i]))
+        {
+            benchmarkOBJLoad(runner, name, filename, syntheticSizes[i], options);
+            remove(filename);
+        }
+    }
+}
+
+// Builds the single interleaved vertex buffer from GeometryData's separate position, texture
+// coordinate and normal arrays, like initGL() does
+static void benchmarkInterleave(BenchmarkRunner& runner, const string& dataDirectory)
+{
+    if(!runner.enabled("interleave/sphere-fixed"))
+    {
+        return;
+    }
+    NullBuffer nullBuffer;
+    streambuf* previous = cout.rdbuf(&nullBuffer);
+    GeometryData geometry;
+    geometry.loadFromOBJFile(dataDirectory + "/sphere-fixed.obj");
+    cout.rdbuf(previous);
+    vector<float> data;
+
+    runner.run("interleave/sphere-fixed", geometry.vertexCount(), BenchmarkOptions(), [&](int64_t iterations)
+    {
+        for(int64_t i=0; i<iterations; i++)
+        {
+            geometry.interleavedVertexData(data);
+            doNotOptimize(data[0]);
+        }
+    });
+}
+
+static void benchmarkTangents(BenchmarkRunner& runner)
+{
+    // Random triangles, so the branch on degenerate UVs can't be predicted from a pattern
+    const int faceCount = 1 << 16;
+    vector<float> positions(faceCount * 9);
+    vector<float> texCoords(faceCount * 6);
+    srand(1);
+    for(size_t i=0; i<positions.size(); i++)
+    {
+        positions[i] = (float)rand() / RAND_MAX;
+    }
+    for(size_t i=0; i<texCoords.size(); i++)
+    {
+        texCoords[i] = (float)rand() / RAND_MAX;
+    }
+    vector<float> tangents(faceCount * 3);
+    vector<float> bitangents(faceCount * 3);
+
+    runner.run("tangents/computeFaceTangent", faceCount, BenchmarkOptions(), [&](int64_t iterations)
+    {
+        for(int64_t i=0; i<iterations; i++)
+        {
+            for(int face=0; face<faceCount; face++)
+            {
+                const float* p = &positions[face * 9];
+                const float* uv = &texCoords[face * 6];
+                computeFaceTangent(p, p + 3, p + 6, uv, uv + 2, uv + 4, &tangents[face * 3], &bitangents[face * 3]);
+            }
+            doNotOptimize(tangents[0]);
+        }
+    });
+}
+
+// The matrix work render() does for one frame: the camera's view and projection, and a model
+// matrix per body (the shader multiplies them, the combined matrix is what it would cost on the CPU)
+static void benchmarkMatrices(BenchmarkRunner& runner)
+{
+    vector<BodyState> bodies;
+    computeBodyStates(30.0f, 120.0f, bodies);
+    float theta = 0.0f;
+    float phi = 45.0f;
+
+    runner.run("matrices/frame_mvp", (double)bodies.size(), BenchmarkOptions(), [&](int64_t iterations)
+    {
+        for(int64_t i=0; i<iterations; i++)
+        {
+            theta += 0.1f;
+            glm::vec3 cameraPosition = glm::vec3(10.0f * cos(glm::radians(theta)) * sin(glm::radians(phi)),
+                                                 10.0f * sin(glm::radians(theta)) * sin(glm::radians(phi)),
+                                                 10.0f * cos(glm::radians(phi)));
+            glm::mat4 view = glm::lookAt(cameraPosition, glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+            glm::mat4 projection = glm::perspective(glm::radians(150.0f), 640.0f / 480.0f, 0.1f, 100.0f);
+            glm::mat4 viewProjection = projection * view;
+            for(size_t b=0; b<bodies.size(); b++)
+            {
+                glm::mat4 mvp = viewProjection * bodyModelMatrix(bodies[b]);
+                doNotOptimize(mvp);
+            }
+        }
+    });
+}
+
+static void benchmarkOrbits(BenchmarkRunner& runner)
+{
+    vector<BodyState> bodies;
+    float alpha = 0.0f;
+    float beta = 0.0f;
+
+    runner.run("orbits/computeBodyStates", 3, BenchmarkOptions(), [&](int64_t iterations)
+    {
+        for(int64_t i=0; i<iterations; i++)
+        {
+            alpha += 1.0f;
+            beta += 4.0f;
+            computeBodyStates(alpha, beta, bodies);
+            doNotOptimize(bodies[2].position);
+        }
+    });
+}
+
+// Thread counts to measure the job system's scaling at: 1, 2, 4, ... and every core
+static vector<int> scalingThreadCounts()
+{
+    int cores = (int)thread::hardware_concurrency();
+    cores = (cores < 1) ? 1 : cores;
+    vector<int> counts;
+    for(int threads=1; threads<cores; threads*=2)
+    {
+        counts.push_back(threads);
+    }
+    counts.push_back(cores);
+    return counts;
+}
+
+// The kernels that run on the job system, at every thread count. With one thread the job system
+// runs single-threaded, where parallelFor() is a plain loop, so that is the serial baseline the
+// other counts compare against.
+static void benchmarkJobScaling(BenchmarkRunner& runner)
+{
+    const int faceCount = 1 << 18;
+    vector<float> positions(faceCount * 9);
+    vector<float> texCoords(faceCount * 6);
+    srand(1);
+    for(size_t i=0; i<positions.size(); i++)
+    {
+        positions[i] = (float)rand() / RAND_MAX;
+    }
+    for(size_t i=0; i<texCoords.size(); i++)
+    {
+        texCoords[i] = (float)rand() / RAND_MAX;
+    }
+    vector<float> tangents(faceCount * 3);
+    vector<float> bitangents(faceCount * 3);
+
+    const int imageWidth = 2048;
+    const int imageHeight = 1024;
+    vector<unsigned char> image((size_t)imageWidth * imageHeight * 4);
+    for(size_t i=0; i<image.size(); i++)
+    {
+        image[i] = (unsigned char)rand();
+    }
+    vector<unsigned char> encoded(bcEncodedSize(BC1, imageWidth, imageHeight));
+
+    // NOTE: The OBJ file takes a while to write, so only when one of its benchmarks will run
+    vector<int> threadCounts = scalingThreadCounts();
+    const int objTriangles = 250000;
+    const char* objFilename = "jobs_scaling.obj";
+    bool needOBJ = false;
+    for(size_t t=0; t<threadCounts.size(); t++)
+    {
+        char name[64];
+        snprintf(name, sizeof(name), "jobs/obj_load/threads_%d", threadCounts[t]);
+        needOBJ = needOBJ || runner.enabled(name);
+    }
+    bool haveOBJ = needOBJ && writeSyntheticOBJ(objFilename, objTriangles);
+    BenchmarkOptions objOptions;
+    objOptions.warmupSeconds = 0.0;
+    objOptions.minSampleSeconds = 0.0;
+    objOptions.minSeconds = 0.0;
+    objOptions.minSamples = 3;
+    objOptions.maxSamples = 10;
+
+    for(size_t t=0; t<threadCounts.size(); t++)
+    {
+        int threads = threadCounts[t];
+        jobsystem::init(threads - 1);
+        char name[64];
+
+        snprintf(name, sizeof(name), "jobs/tangents/threads_%d", threads);
+        runner.run(name, faceCount, BenchmarkOptions(), [&](int64_t iterations)
+        {
+            for(int64_t i=0; i<iterations; i++)
+            {
+                jobsystem::parallelFor(faceCount, 4096, [&](size_t first, size_t last)
+                {
+                    for(size_t face=first; face<last; face++)
+                    {
+                        const float* p = &positions[face * 9];
+                        const float* uv = &texCoords[face * 6];
+                        computeFaceTangent(p, p + 3, p + 6, uv, uv + 2, uv + 4, &tangents[face * 3],
+                                           &bitangents[face * 3]);
+                    }
+                });
+                doNotOptimize(tangents[0]);
+            }
+        });
+
+        snprintf(name, sizeof(name), "jobs/bc1_encode/threads_%d", threads);
+        runner.run(name, (double)imageWidth * imageHeight, BenchmarkOptions(), [&](int64_t iterations)
+        {
+            for(int64_t i=0; i<iterations; i++)
+            {
+                bcEncodeImage(BC1, image.data(), imageWidth, imageHeight, encoded.data());
+                doNotOptimize(encoded[0]);
+            }
+        });
+
+        snprintf(name, sizeof(name), "jobs/obj_load/threads_%d", threads);
+        if(haveOBJ)
+        {
+            benchmarkOBJLoad(runner, name, objFilename, objTriangles, objOptions);
+        }
+
+        jobsystem::shutdown();
+    }
+    if(haveOBJ)
+    {
+        remove(objFilename);
+    }
+}
+
+static void printUsage(const char* program)
+{
+    printf("Usage: %s [options]\n", program);
+    printf("  --filter TEXT       Only run benchmarks whose name contains TEXT\n");
+    printf("  --output FILE       Write the results as JSON to FILE (default microbench.json)\n");
+    printf("  --data DIR          Directory containing sphere-fixed.obj (default .)\n");
+    printf("  --triangles N       Benchmark loading a synthetic N triangle OBJ (can be repeated,\n");
+    printf("                      default 1000000 and 4000000)\n");
+}
+
+int main(int argc, char** argv)
+{
+    string filter;
+    string output = "microbench.json";
+    string dataDirectory = ".";
+    vector<int> syntheticSizes;
+    for(int i=1; i<argc; i++)
+    {
+        if(strcmp(argv[i], "--filter") == 0 && i+1 < argc)
+        {
+            filter = argv[++i];
+        }
+        else if(strcmp(argv[i], "--output") == 0 && i+1 < argc)
+        {
+            output = argv[++i];
+        }
+        else if(strcmp(argv[i], "--data") == 0 && i+1 < argc)
+        {
+            dataDirectory = argv[++i];
+        }
+        else if(strcmp(argv[i], "--triangles") == 0 && i+1 < argc)
+        {
+            syntheticSizes.push_back(atoi(argv[++i]));
+        }
+        else
+        {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+    if(syntheticSizes.empty())
+    {
+        syntheticSizes.push_back(1000000);
+        syntheticSizes.push_back(4000000);
+    }
+
+    // NOTE: Without counters the benchmarks still run, they just report timings only. The runner
+    //       reads them around every sample, so the regions inside the kernels are switched off.
+    perfcounters::init();
+    perfcounters::setRegionsEnabled(false);
+
+    BenchmarkRunner runner(filter);
+    benchmarkOrbits(runner);
+    benchmarkMatrices(runner);
+    benchmarkTangents(runner);
+    benchmarkInterleave(runner, dataDirectory);
+    benchmarkLoader(runner, dataDirectory, syntheticSizes);
+    benchmarkJobScaling(runner);
+
+    perfcounters::shutdown();
+
+    return runner.writeJSON(output) ? 0 : 1;
+}
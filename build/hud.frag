@@ -0,0 +1,14 @@
+#version 330 core
+
+in vec2 TexCoord;
+in vec4 Color;
+
+out vec4 outColor;
+
+// Single-channel glyph atlas; solid quads sample a cell that is fully set
+uniform sampler2D Font;
+
+void main()
+{
+    outColor = vec4(Color.rgb, Color.a * texture(Font, TexCoord).r);
+}
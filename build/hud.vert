@@ -0,0 +1,18 @@
+#version 330 core
+layout (location = 0) in vec2 position;
+layout (location = 1) in vec2 Tex;
+layout (location = 2) in vec4 color;
+
+out vec2 TexCoord;
+out vec4 Color;
+
+// Window size in pixels; HUD vertices are given in pixels from the top-left corner
+uniform vec2 ScreenSize;
+
+void main()
+{
+    vec2 ndc = position / ScreenSize * 2.0 - 1.0;
+    gl_Position = vec4(ndc.x, -ndc.y, 0.0, 1.0);
+    TexCoord = Tex;
+    Color = color;
+}
@@ -6,40 +6,46 @@ in vec3 Normal;
 
 out vec4 outColor;
 
-uniform sampler2D Texture;
+flat in float TextureLayer;
 
-struct Material {
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-    float shininess;
-};
+// Body textures are layers of an array texture; TextureLayer picks this instance's layer
+uniform sampler2DArray Texture;
 
-struct Light {
-    vec3 position;
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
+// Per-frame state, shared with simple.vert and written once per frame by OpenGLWindow
+layout (std140) uniform FrameData
+{
+    mat4 view;
+    mat4 projection;
+    vec4 viewPos;
+    vec4 lightPosition;
+    vec4 lightAmbient;
+    vec4 lightDiffuse;
+    vec4 lightSpecular;
 };
 
-uniform Material material;
-uniform Light light;
-uniform vec3 viewPos;
+// Constant material, written once at startup
+layout (std140) uniform MaterialData
+{
+    vec4 materialAmbient;
+    vec4 materialDiffuse;
+    vec4 materialSpecular;
+    float materialShininess;
+};
 
 void main()
 {
-    vec3 ambient = light.ambient * material.ambient;
+    vec3 ambient = lightAmbient.rgb * materialAmbient.rgb;
 
     vec3 norm = normalize(Normal);
-    vec3 lightDir = normalize(light.position - FragPos);
+    vec3 lightDir = normalize(lightPosition.xyz - FragPos);
     float diff = max(dot(norm, lightDir), 0.0);
-    vec3 diffuse = light.diffuse * (diff * material.diffuse);
+    vec3 diffuse = lightDiffuse.rgb * (diff * materialDiffuse.rgb);
 
-    vec3 viewDir = normalize(viewPos - FragPos);
+    vec3 viewDir = normalize(viewPos.xyz - FragPos);
     vec3 reflectDir = reflect(-lightDir, norm);
-    float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
-    vec3 specular = light.specular * (spec * material.specular);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), materialShininess);
+    vec3 specular = lightSpecular.rgb * (spec * materialSpecular.rgb);
     
     vec3 result = ambient + diffuse + specular;
-    outColor = texture(Texture, TexCoord) * vec4(result, 1.0);
+    outColor = texture(Texture, vec3(TexCoord, TextureLayer)) * vec4(result, 1.0);
 }
@@ -3,21 +3,37 @@ layout (location = 0) in vec3 position;
 layout (location = 1) in vec2 Tex;
 layout (location = 2) in vec3 normal;
 
+// Per-instance attributes (see OpenGLWindow::BodyInstance)
+layout (location = 3) in mat4 model;
+layout (location = 7) in float textureLayer;
+
 
 out vec2 TexCoord; // Add a output variable for texture coordinates
 out vec3 FragPos;
 out vec3 Normal;
+flat out float TextureLayer;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+// Per-frame state, shared with simple.frag and written once per frame by OpenGLWindow
+layout (std140) uniform FrameData
+{
+    mat4 view;
+    mat4 projection;
+    vec4 viewPos;
+    vec4 lightPosition;
+    vec4 lightAmbient;
+    vec4 lightDiffuse;
+    vec4 lightSpecular;
+};
 
 
 void main()
 {
     FragPos = vec3(model * vec4(position, 1.0));
-    Normal = mat3(transpose(inverse(model))) * normal;
+    // Bodies are only ever translated and uniformly scaled, so the upper 3x3 of the model matrix
+    // keeps normals pointing the right way (the fragment shader renormalizes them)
+    Normal = mat3(model) * normal;
     TexCoord = Tex;
+    TextureLayer = textureLayer;
     gl_Position = projection * view * vec4(FragPos, 1.0);
     
 }
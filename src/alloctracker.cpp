@@ -0,0 +1,307 @@
+#include <atomic>
+#include <new>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(ALLOC_TRACKING) && defined(__GLIBC__)
+#include <execinfo.h>
+#define ALLOC_TRACKER_BACKTRACE
+#endif
+
+#include "alloctracker.h"
+
+using namespace std;
+
+#ifndef ALLOC_TRACKING
+
+namespace alloctracker
+{
+    bool enabled()
+    {
+        return false;
+    }
+
+    void endFrame()
+    {
+    }
+
+    unsigned int lastFrameAllocations()
+    {
+        return 0;
+    }
+
+    size_t lastFrameBytes()
+    {
+        return 0;
+    }
+
+    void printLastFrameSites()
+    {
+    }
+
+    void printReport(int maxSites)
+    {
+    }
+}
+
+#else
+
+namespace alloctracker
+{
+    static const int SITE_CAPACITY = 4096;
+    static const int SITE_DEPTH = 10;
+
+    // The first two frames of every backtrace are recordAllocation() and operator new itself
+    static const int SKIPPED_FRAMES = 2;
+
+    struct Site
+    {
+        atomic<uint64_t> key;
+        void* frames[SITE_DEPTH];
+        int frameCount;
+        atomic<unsigned int> allocations;
+        atomic<size_t> bytes;
+        atomic<unsigned int> frameAllocations;
+        atomic<size_t> frameBytes;
+        unsigned int lastFrameAllocations;
+        size_t lastFrameBytes;
+    };
+
+    static Site sites[SITE_CAPACITY];
+    static atomic<int> droppedSites(0);
+    static atomic<unsigned int> frameAllocations(0);
+    static atomic<size_t> frameBytes(0);
+    static unsigned int closedFrameAllocations = 0;
+    static size_t closedFrameBytes = 0;
+
+    // backtrace() may allocate the first time it's used, which must not be tracked (or recurse)
+    static thread_local bool insideTracker = false;
+
+    static uint64_t hashFrames(void* const* frames, int count)
+    {
+        uint64_t hash = 14695981039346656037ULL;
+        for(int i=0; i<count; i++)
+        {
+            hash = (hash ^ (uint64_t)(uintptr_t)frames[i]) * 1099511628211ULL;
+        }
+        return hash ? hash : 1;
+    }
+
+#ifdef __GNUC__
+    __attribute__((noinline))
+#endif
+    static void recordAllocation(size_t size)
+    {
+        if(insideTracker)
+        {
+            return;
+        }
+        insideTracker = true;
+
+        frameAllocations.fetch_add(1, memory_order_relaxed);
+        frameBytes.fetch_add(size, memory_order_relaxed);
+
+        void* stack[SITE_DEPTH + SKIPPED_FRAMES];
+#ifdef ALLOC_TRACKER_BACKTRACE
+        int depth = backtrace(stack, SITE_DEPTH + SKIPPED_FRAMES);
+#else
+        stack[SKIPPED_FRAMES] = __builtin_return_address(0);
+        int depth = SKIPPED_FRAMES + 1;
+#endif
+        void** frames = stack + SKIPPED_FRAMES;
+        int frameCount = (depth > SKIPPED_FRAMES) ? depth - SKIPPED_FRAMES : 0;
+        uint64_t key = hashFrames(frames, frameCount);
+
+        // Open addressing; a slot is claimed by swapping its key in, and never released
+        int slot = (int)(key % SITE_CAPACITY);
+        for(int probe=0; probe<SITE_CAPACITY; probe++)
+        {
+            Site& site = sites[slot];
+            uint64_t current = site.key.load(memory_order_acquire);
+            if(current == 0)
+            {
+                uint64_t empty = 0;
+                if(site.key.compare_exchange_strong(empty, key, memory_order_acq_rel))
+                {
+                    memcpy(site.frames, frames, sizeof(void*) * frameCount);
+                    site.frameCount = frameCount;
+                    current = key;
+                }
+                else
+                {
+                    current = empty;
+                }
+            }
+            if(current == key)
+            {
+                site.allocations.fetch_add(1, memory_order_relaxed);
+                site.bytes.fetch_add(size, memory_order_relaxed);
+                site.frameAllocations.fetch_add(1, memory_order_relaxed);
+                site.frameBytes.fetch_add(size, memory_order_relaxed);
+                insideTracker = false;
+                return;
+            }
+            slot = (slot + 1) % SITE_CAPACITY;
+        }
+        droppedSites.fetch_add(1, memory_order_relaxed);
+        insideTracker = false;
+    }
+
+    static void printSite(const Site& site, unsigned int allocations, size_t bytes)
+    {
+        printf("  %8u allocations %10zu bytes\n", allocations, bytes);
+#ifdef ALLOC_TRACKER_BACKTRACE
+        insideTracker = true;
+        char** symbols = backtrace_symbols(site.frames, site.frameCount);
+        for(int i=0; i<site.frameCount; i++)
+        {
+            printf("      %s\n", symbols ? symbols[i] : "?");
+        }
+        free(symbols);
+        insideTracker = false;
+#else
+        for(int i=0; i<site.frameCount; i++)
+        {
+            printf("      %p\n", site.frames[i]);
+        }
+#endif
+    }
+
+    bool enabled()
+    {
+        return true;
+    }
+
+    void endFrame()
+    {
+        closedFrameAllocations = frameAllocations.exchange(0, memory_order_relaxed);
+        closedFrameBytes = frameBytes.exchange(0, memory_order_relaxed);
+        for(int i=0; i<SITE_CAPACITY; i++)
+        {
+            sites[i].lastFrameAllocations = sites[i].frameAllocations.exchange(0, memory_order_relaxed);
+            sites[i].lastFrameBytes = sites[i].frameBytes.exchange(0, memory_order_relaxed);
+        }
+    }
+
+    unsigned int lastFrameAllocations()
+    {
+        return closedFrameAllocations;
+    }
+
+    size_t lastFrameBytes()
+    {
+        return closedFrameBytes;
+    }
+
+    void printLastFrameSites()
+    {
+        for(int i=0; i<SITE_CAPACITY; i++)
+        {
+            if(sites[i].lastFrameAllocations > 0)
+            {
+                printSite(sites[i], sites[i].lastFrameAllocations, sites[i].lastFrameBytes);
+            }
+        }
+    }
+
+    void printReport(int maxSites)
+    {
+        // Repeatedly pick the largest remaining site; the table is small and this only runs once
+        static bool printed[SITE_CAPACITY];
+        memset(printed, 0, sizeof(printed));
+
+        unsigned int totalAllocations = 0;
+        size_t totalBytes = 0;
+        for(int i=0; i<SITE_CAPACITY; i++)
+        {
+            totalAllocations += sites[i].allocations.load(memory_order_relaxed);
+            totalBytes += sites[i].bytes.load(memory_order_relaxed);
+        }
+        printf("Heap allocations: %u (%zu bytes), top call sites:\n", totalAllocations, totalBytes);
+
+        for(int n=0; n<maxSites; n++)
+        {
+            int best = -1;
+            for(int i=0; i<SITE_CAPACITY; i++)
+            {
+                if(!printed[i] && sites[i].allocations.load(memory_order_relaxed) > 0 &&
+                   (best < 0 || sites[i].allocations.load(memory_order_relaxed) > sites[best].allocations.load(memory_order_relaxed)))
+                {
+                    best = i;
+                }
+            }
+            if(best < 0)
+            {
+                break;
+            }
+            printed[best] = true;
+            printSite(sites[best], sites[best].allocations.load(memory_order_relaxed),
+                      sites[best].bytes.load(memory_order_relaxed));
+        }
+        if(droppedSites.load(memory_order_relaxed) > 0)
+        {
+            printf("  (%d allocations came from sites that didn't fit in the table)\n", droppedSites.load(memory_order_relaxed));
+        }
+    }
+}
+
+// NOTE: Replacing these four (plus their nothrow versions) is enough for every allocation that
+//       goes through new, including the standard containers. The matching deletes have to be
+//       replaced too, since they must free with the allocator the news used.
+void* operator new(size_t size)
+{
+    alloctracker::recordAllocation(size);
+    void* pointer = malloc(size ? size : 1);
+    if(!pointer)
+    {
+        throw std::bad_alloc();
+    }
+    return pointer;
+}
+
+void* operator new[](size_t size)
+{
+    alloctracker::recordAllocation(size);
+    void* pointer = malloc(size ? size : 1);
+    if(!pointer)
+    {
+        throw std::bad_alloc();
+    }
+    return pointer;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    alloctracker::recordAllocation(size);
+    return malloc(size ? size : 1);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+    alloctracker::recordAllocation(size);
+    return malloc(size ? size : 1);
+}
+
+void operator delete(void* pointer) noexcept
+{
+    free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept
+{
+    free(pointer);
+}
+
+void operator delete(void* pointer, const std::nothrow_t&) noexcept
+{
+    free(pointer);
+}
+
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept
+{
+    free(pointer);
+}
+
+#endif
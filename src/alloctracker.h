@@ -0,0 +1,35 @@
+#ifndef ALLOC_TRACKER_H
+#define ALLOC_TRACKER_H
+
+#include <stddef.h>
+
+// Counts heap allocations per frame and per call site. Only active in builds with
+// -DALLOC_TRACKING (make ALLOC_TRACKING=1), which replace the global operator new/delete; in
+// normal builds enabled() is false and everything else reports nothing.
+//
+// A call site is the short stack above operator new (glibc's backtrace(), so link with -rdynamic
+// to see function names), which points past the std::vector/std::string internals to the code
+// that actually caused the allocation. Sites are kept in a fixed-size table that is never
+// allocated from the heap, so the tracker can't count itself.
+//
+// After warm-up the renderer shouldn't allocate at all; main() checks every steady-state frame
+// with lastFrameAllocations() and fails loudly when one does.
+namespace alloctracker
+{
+    bool enabled();
+
+    // Closes the current frame's counts (available through the lastFrame* functions below) and
+    // starts counting a new frame. Allocations from every thread count towards the frame.
+    void endFrame();
+
+    unsigned int lastFrameAllocations();
+    size_t lastFrameBytes();
+
+    // Prints the call sites that allocated during the last closed frame
+    void printLastFrameSites();
+
+    // Prints the call sites with the most allocations over the whole run
+    void printReport(int maxSites=20);
+}
+
+#endif
@@ -0,0 +1,233 @@
+#include <string.h>
+
+#include "bcencoder.h"
+#include "jobsystem.h"
+
+using namespace std;
+
+// A 2048 pixel wide row of blocks takes a few tens of microseconds, so jobs of this many rows are
+// long enough to be worth stealing and short enough to spread a mip level over every core
+static const size_t BLOCK_ROWS_PER_JOB = 8;
+
+static unsigned short packColor565(const int* color)
+{
+    return (unsigned short)(((color[0] >> 3) << 11) | ((color[1] >> 2) << 5) | (color[2] >> 3));
+}
+
+static void unpackColor565(unsigned short packed, int* color)
+{
+    int r = (packed >> 11) & 31;
+    int g = (packed >> 5) & 63;
+    int b = packed & 31;
+    color[0] = (r << 3) | (r >> 2);
+    color[1] = (g << 2) | (g >> 4);
+    color[2] = (b << 3) | (b >> 2);
+}
+
+// block is 16 RGBA pixels in row order
+static void encodeColorBlock(const unsigned char* block, unsigned char* output)
+{
+    int minColor[3] = {255, 255, 255};
+    int maxColor[3] = {0, 0, 0};
+    int mean[3] = {0, 0, 0};
+    for(int i=0; i<16; i++)
+    {
+        for(int c=0; c<3; c++)
+        {
+            int value = block[4*i + c];
+            minColor[c] = (value < minColor[c]) ? value : minColor[c];
+            maxColor[c] = (value > maxColor[c]) ? value : maxColor[c];
+            mean[c] += value;
+        }
+    }
+
+    // The bounding box only tells us the extent, not which diagonal the colours lie along. Flip
+    // red and/or blue relative to green if they are anti-correlated with it.
+    int covarianceRG = 0;
+    int covarianceBG = 0;
+    for(int i=0; i<16; i++)
+    {
+        int r = 16*block[4*i] - mean[0];
+        int g = 16*block[4*i + 1] - mean[1];
+        int b = 16*block[4*i + 2] - mean[2];
+        covarianceRG += r*g;
+        covarianceBG += b*g;
+    }
+    if(covarianceRG < 0)
+    {
+        int swap = minColor[0];
+        minColor[0] = maxColor[0];
+        maxColor[0] = swap;
+    }
+    if(covarianceBG < 0)
+    {
+        int swap = minColor[2];
+        minColor[2] = maxColor[2];
+        maxColor[2] = swap;
+    }
+
+    // Pull the endpoints in by 1/16th of the range, since the extremes rarely sit on them exactly
+    for(int c=0; c<3; c++)
+    {
+        int inset = (maxColor[c] - minColor[c]) / 16;
+        minColor[c] += inset;
+        maxColor[c] -= inset;
+    }
+
+    unsigned short color0 = packColor565(maxColor);
+    unsigned short color1 = packColor565(minColor);
+    if(color0 < color1)
+    {
+        unsigned short swap = color0;
+        color0 = color1;
+        color1 = swap;
+    }
+
+    // NOTE: color0 > color1 selects the 4 colour mode. When they are equal the block is a flat
+    //       colour, and leaving every index at 0 avoids the 3 colour mode's transparent black.
+    unsigned int indices = 0;
+    if(color0 != color1)
+    {
+        int palette[4][3];
+        unpackColor565(color0, palette[0]);
+        unpackColor565(color1, palette[1]);
+        for(int c=0; c<3; c++)
+        {
+            palette[2][c] = (2*palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2*palette[1][c]) / 3;
+        }
+
+        for(int i=0; i<16; i++)
+        {
+            int bestIndex = 0;
+            int bestDistance = 0x7FFFFFFF;
+            for(int p=0; p<4; p++)
+            {
+                int dr = block[4*i] - palette[p][0];
+                int dg = block[4*i + 1] - palette[p][1];
+                int db = block[4*i + 2] - palette[p][2];
+                int distance = dr*dr + dg*dg + db*db;
+                if(distance < bestDistance)
+                {
+                    bestDistance = distance;
+                    bestIndex = p;
+                }
+            }
+            indices |= (unsigned int)bestIndex << (2*i);
+        }
+    }
+
+    output[0] = color0 & 0xFF;
+    output[1] = color0 >> 8;
+    output[2] = color1 & 0xFF;
+    output[3] = color1 >> 8;
+    for(int i=0; i<4; i++)
+    {
+        output[4 + i] = (indices >> (8*i)) & 0xFF;
+    }
+}
+
+static void encodeAlphaBlock(const unsigned char* block, unsigned char* output)
+{
+    int minAlpha = 255;
+    int maxAlpha = 0;
+    for(int i=0; i<16; i++)
+    {
+        int alpha = block[4*i + 3];
+        minAlpha = (alpha < minAlpha) ? alpha : minAlpha;
+        maxAlpha = (alpha > maxAlpha) ? alpha : maxAlpha;
+    }
+
+    // alpha0 > alpha1 selects the 8 value mode: the two endpoints plus 6 interpolated values
+    unsigned long long indices = 0;
+    if(maxAlpha > minAlpha)
+    {
+        int palette[8];
+        palette[0] = maxAlpha;
+        palette[1] = minAlpha;
+        for(int p=1; p<7; p++)
+        {
+            palette[p+1] = ((7-p)*maxAlpha + p*minAlpha) / 7;
+        }
+
+        for(int i=0; i<16; i++)
+        {
+            int alpha = block[4*i + 3];
+            int bestIndex = 0;
+            int bestDistance = 256;
+            for(int p=0; p<8; p++)
+            {
+                int distance = (alpha > palette[p]) ? alpha - palette[p] : palette[p] - alpha;
+                if(distance < bestDistance)
+                {
+                    bestDistance = distance;
+                    bestIndex = p;
+                }
+            }
+            indices |= (unsigned long long)bestIndex << (3*i);
+        }
+    }
+
+    output[0] = (unsigned char)maxAlpha;
+    output[1] = (unsigned char)minAlpha;
+    for(int i=0; i<6; i++)
+    {
+        output[2 + i] = (indices >> (8*i)) & 0xFF;
+    }
+}
+
+static void encodeBlockRows(BCFormat format, const unsigned char* rgba, int width, int height,
+                            unsigned char* output, int firstRow, int lastRow)
+{
+    int blocksWide = (width + 3) / 4;
+    size_t blockSize = bcBlockSize(format);
+    unsigned char block[64];
+    for(int blockY=firstRow; blockY<lastRow; blockY++)
+    {
+        for(int blockX=0; blockX<blocksWide; blockX++)
+        {
+            // Partial blocks at the right/top edges repeat the last row/column
+            for(int y=0; y<4; y++)
+            {
+                int sourceY = 4*blockY + y;
+                sourceY = (sourceY < height) ? sourceY : height-1;
+                for(int x=0; x<4; x++)
+                {
+                    int sourceX = 4*blockX + x;
+                    sourceX = (sourceX < width) ? sourceX : width-1;
+                    memcpy(&block[4*(4*y + x)], &rgba[4*((size_t)sourceY*width + sourceX)], 4);
+                }
+            }
+
+            unsigned char* blockOutput = output + ((size_t)blockY*blocksWide + blockX)*blockSize;
+            if(format == BC3)
+            {
+                encodeAlphaBlock(block, blockOutput);
+                blockOutput += 8;
+            }
+            encodeColorBlock(block, blockOutput);
+        }
+    }
+}
+
+size_t bcBlockSize(BCFormat format)
+{
+    return (format == BC1) ? 8 : 16;
+}
+
+size_t bcEncodedSize(BCFormat format, int width, int height)
+{
+    size_t blocksWide = (width + 3) / 4;
+    size_t blocksHigh = (height + 3) / 4;
+    return blocksWide * blocksHigh * bcBlockSize(format);
+}
+
+void bcEncodeImage(BCFormat format, const unsigned char* rgba, int width, int height,
+                   unsigned char* output)
+{
+    int blocksHigh = (height + 3) / 4;
+    jobsystem::parallelFor(blocksHigh, BLOCK_ROWS_PER_JOB, [&](size_t firstRow, size_t lastRow)
+    {
+        encodeBlockRows(format, rgba, width, height, output, (int)firstRow, (int)lastRow);
+    });
+}
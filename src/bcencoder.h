@@ -0,0 +1,26 @@
+#ifndef BC_ENCODER_H
+#define BC_ENCODER_H
+
+#include <stddef.h>
+
+// A small CPU encoder for the S3TC block compressed formats. Each 4x4 block of pixels is stored
+// as two 565 endpoint colours plus 2 bit indices into the palette interpolated between them
+// (BC1, 8 bytes per block), optionally preceded by a block of 8 bit alpha endpoints and 3 bit
+// indices (BC3, 16 bytes per block). Endpoints come from the block's inset bounding box, which
+// is fast and looks fine on photographic body textures.
+enum BCFormat
+{
+    BC1,
+    BC3
+};
+
+size_t bcBlockSize(BCFormat format);
+
+// Size of the encoded data for an image, including the padding of partial edge blocks
+size_t bcEncodedSize(BCFormat format, int width, int height);
+
+// Encodes tightly packed RGBA8 pixels, with the block rows spread over the job system
+void bcEncodeImage(BCFormat format, const unsigned char* rgba, int width, int height,
+                   unsigned char* output);
+
+#endif
@@ -0,0 +1,285 @@
+#include <algorithm>
+#include <iostream>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "benchmark.h"
+#include "perfcounters.h"
+
+using namespace std;
+
+// Keys in the order they appear in the report. Lower is better for all of them.
+static const char* COMPARED_KEYS[] =
+{
+    "cpu_mean_ms", "cpu_p50_ms", "cpu_p95_ms", "cpu_p99_ms",
+    "gpu_mean_ms", "gpu_p50_ms", "gpu_p95_ms", "gpu_p99_ms"
+};
+
+// Finds "key": <number> in a flat JSON object. Good enough for the reports we write ourselves.
+static bool findJSONNumber(const string& json, const char* key, double& value)
+{
+    string quotedKey = string("\"") + key + "\"";
+    size_t position = json.find(quotedKey);
+    if(position == string::npos)
+    {
+        return false;
+    }
+    position = json.find(':', position + quotedKey.size());
+    if(position == string::npos)
+    {
+        return false;
+    }
+    const char* start = json.c_str() + position + 1;
+    char* end;
+    value = strtod(start, &end);
+    return end != start;
+}
+
+FrameBenchmark::FrameBenchmark(int frameCount, int warmupFrames)
+    : frameCount(frameCount), warmupFrames(warmupFrames), glCallTotal(0.0), redundantGlCallTotal(0.0), glCallMax(0)
+{
+    cpuTimes.reserve(frameCount);
+    gpuTimes.reserve(frameCount);
+}
+
+int FrameBenchmark::totalFrames()
+{
+    return warmupFrames + frameCount;
+}
+
+// The measured frames are split into four equally long camera paths, each with its own fixed
+// orbit state: a full orbit around the scene, a pitch sweep from above to the side, a zoom in,
+// and a combined path that moves everything at once
+BenchmarkState FrameBenchmark::state(int frame)
+{
+    int measuredFrame = (frame > warmupFrames) ? frame - warmupFrames : 0;
+    int segmentLength = (frameCount >= 4) ? frameCount/4 : 1;
+    int segment = measuredFrame / segmentLength;
+    float t = (float)(measuredFrame % segmentLength) / segmentLength;
+
+    BenchmarkState state;
+    switch(segment)
+    {
+    case 0:
+        state.theta = 360.0f * t;
+        state.phi = 45.0f;
+        state.zoom = 150.0f;
+        state.alpha = 30.0f;
+        state.beta = 120.0f;
+        break;
+    case 1:
+        state.theta = 45.0f;
+        state.phi = 90.0f * t;
+        state.zoom = 150.0f;
+        state.alpha = 120.0f;
+        state.beta = 300.0f;
+        break;
+    case 2:
+        state.theta = 90.0f;
+        state.phi = 60.0f;
+        state.zoom = 150.0f - 110.0f * t;
+        state.alpha = 200.0f;
+        state.beta = 45.0f;
+        break;
+    default:
+        state.theta = 360.0f * t;
+        state.phi = 30.0f + 30.0f * sin(6.2831853f * t);
+        state.zoom = 90.0f + 50.0f * cos(6.2831853f * t);
+        state.alpha = 300.0f;
+        state.beta = 270.0f;
+        break;
+    }
+    return state;
+}
+
+void FrameBenchmark::record(int frame, double cpuMs, double gpuMs, unsigned int glCalls, unsigned int redundantGlCalls)
+{
+    if(frame < warmupFrames)
+    {
+        return;
+    }
+    cpuTimes.push_back(cpuMs);
+    if(gpuMs >= 0.0)
+    {
+        gpuTimes.push_back(gpuMs);
+    }
+    glCallTotal += glCalls;
+    redundantGlCallTotal += redundantGlCalls;
+    glCallMax = (glCalls > glCallMax) ? glCalls : glCallMax;
+}
+
+unsigned int FrameBenchmark::maxGlCalls()
+{
+    return glCallMax;
+}
+
+void FrameBenchmark::addGpuScope(const string& name, double averageMs, double maxMs)
+{
+    GpuScope scope;
+    scope.name = name;
+    scope.average = averageMs;
+    scope.max = maxMs;
+    gpuScopes.push_back(scope);
+}
+
+FrameBenchmark::Statistics FrameBenchmark::summarize(vector<double> samples)
+{
+    Statistics statistics = {};
+    if(samples.empty())
+    {
+        return statistics;
+    }
+
+    sort(samples.begin(), samples.end());
+    double sum = 0.0;
+    for(size_t i=0; i<samples.size(); i++)
+    {
+        sum += samples[i];
+    }
+    statistics.mean = sum / samples.size();
+
+    // Nearest-rank percentiles
+    double percentiles[3] = {50.0, 95.0, 99.0};
+    double* results[3] = {&statistics.p50, &statistics.p95, &statistics.p99};
+    for(int i=0; i<3; i++)
+    {
+        size_t rank = (size_t)ceil(percentiles[i] / 100.0 * samples.size());
+        rank = (rank < 1) ? 1 : rank;
+        *results[i] = samples[rank - 1];
+    }
+    statistics.max = samples.back();
+    return statistics;
+}
+
+void FrameBenchmark::addPerfRegion(const string& name, double calls, double elements, double instructionsPerCycle,
+                                   double cyclesPerElement, double cacheMissesPerElement, double branchMissesPerElement)
+{
+    PerfRegion region;
+    region.name = name;
+    region.calls = calls;
+    region.elements = elements;
+    region.instructionsPerCycle = instructionsPerCycle;
+    region.cyclesPerElement = cyclesPerElement;
+    region.cacheMissesPerElement = cacheMissesPerElement;
+    region.branchMissesPerElement = branchMissesPerElement;
+    perfRegions.push_back(region);
+}
+
+string FrameBenchmark::report()
+{
+    Statistics cpu = summarize(cpuTimes);
+    Statistics gpu = summarize(gpuTimes);
+    double glCalls = cpuTimes.empty() ? 0.0 : glCallTotal / cpuTimes.size();
+    double redundantGlCalls = cpuTimes.empty() ? 0.0 : redundantGlCallTotal / cpuTimes.size();
+
+    char buffer[1024];
+    snprintf(buffer, sizeof(buffer),
+             "{\n"
+             "  \"frames\": %d,\n"
+             "  \"warmup_frames\": %d,\n"
+             "  \"cpu_mean_ms\": %.4f,\n"
+             "  \"cpu_p50_ms\": %.4f,\n"
+             "  \"cpu_p95_ms\": %.4f,\n"
+             "  \"cpu_p99_ms\": %.4f,\n"
+             "  \"cpu_max_ms\": %.4f,\n"
+             "  \"gpu_frames\": %d,\n"
+             "  \"gpu_mean_ms\": %.4f,\n"
+             "  \"gpu_p50_ms\": %.4f,\n"
+             "  \"gpu_p95_ms\": %.4f,\n"
+             "  \"gpu_p99_ms\": %.4f,\n"
+             "  \"gpu_max_ms\": %.4f,\n"
+             "  \"gl_calls_per_frame\": %.1f,\n"
+             "  \"gl_calls_max_per_frame\": %u,\n"
+             "  \"gl_redundant_calls_per_frame\": %.1f",
+             (int)cpuTimes.size(), warmupFrames,
+             cpu.mean, cpu.p50, cpu.p95, cpu.p99, cpu.max,
+             (int)gpuTimes.size(), gpu.mean, gpu.p50, gpu.p95, gpu.p99, gpu.max,
+             glCalls, glCallMax, redundantGlCalls);
+
+    string text = buffer;
+    if(!gpuScopes.empty())
+    {
+        text += ",\n  \"gpu_scopes\": {";
+        for(size_t i=0; i<gpuScopes.size(); i++)
+        {
+            snprintf(buffer, sizeof(buffer), "%s\n    \"%s\": {\"mean_ms\": %.4f, \"max_ms\": %.4f}",
+                     (i > 0) ? "," : "", gpuScopes[i].name.c_str(), gpuScopes[i].average, gpuScopes[i].max);
+            text += buffer;
+        }
+        text += "\n  }";
+    }
+    if(!perfRegions.empty())
+    {
+        text += ",\n  \"perf_regions\": {";
+        for(size_t i=0; i<perfRegions.size(); i++)
+        {
+            const PerfRegion& region = perfRegions[i];
+            snprintf(buffer, sizeof(buffer), "%s\n    \"%s\": {\"calls\": %.0f, \"elements\": %.0f, \"ipc\": %s, "
+                     "\"cycles_per_element\": %s, \"cache_misses_per_element\": %s, \"branch_misses_per_element\": %s}",
+                     (i > 0) ? "," : "", region.name.c_str(), region.calls, region.elements,
+                     perfcounters::counterJSON(region.instructionsPerCycle).c_str(),
+                     perfcounters::counterJSON(region.cyclesPerElement).c_str(),
+                     perfcounters::counterJSON(region.cacheMissesPerElement).c_str(),
+                     perfcounters::counterJSON(region.branchMissesPerElement).c_str());
+            text += buffer;
+        }
+        text += "\n  }";
+    }
+    text += "\n}\n";
+    return text;
+}
+
+bool FrameBenchmark::writeReport(const string& filename)
+{
+    FILE* file = fopen(filename.c_str(), "w");
+    if(!file)
+    {
+        cout << "Unable to write benchmark report: " << filename << endl;
+        return false;
+    }
+    string text = report();
+    fwrite(text.c_str(), 1, text.size(), file);
+    fclose(file);
+    return true;
+}
+
+bool FrameBenchmark::compareWithBaseline(const string& baselineFilename, double thresholdPercent)
+{
+    FILE* file = fopen(baselineFilename.c_str(), "r");
+    if(!file)
+    {
+        cout << "No benchmark baseline at " << baselineFilename << ", saving these results as the baseline" << endl;
+        writeReport(baselineFilename);
+        return true;
+    }
+    string baseline;
+    char buffer[4096];
+    size_t readCount;
+    while((readCount = fread(buffer, 1, sizeof(buffer), file)) > 0)
+    {
+        baseline.append(buffer, readCount);
+    }
+    fclose(file);
+
+    string current = report();
+    bool passed = true;
+    for(size_t i=0; i<sizeof(COMPARED_KEYS)/sizeof(COMPARED_KEYS[0]); i++)
+    {
+        double baselineValue;
+        double currentValue;
+        if(!findJSONNumber(baseline, COMPARED_KEYS[i], baselineValue) ||
+           !findJSONNumber(current, COMPARED_KEYS[i], currentValue) || baselineValue <= 0.0)
+        {
+            continue;
+        }
+
+        double changePercent = 100.0 * (currentValue - baselineValue) / baselineValue;
+        bool regressed = (changePercent > thresholdPercent);
+        printf("%-14s %10.4f -> %10.4f  (%+6.1f%%)%s\n", COMPARED_KEYS[i], baselineValue, currentValue,
+               changePercent, regressed ? "  REGRESSION" : "");
+        passed = passed && !regressed;
+    }
+    return passed;
+}
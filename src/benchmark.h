@@ -0,0 +1,91 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <string>
+#include <vector>
+
+// Camera and orbit state for one benchmark frame
+struct BenchmarkState
+{
+    float theta;
+    float phi;
+    float zoom;
+    float alpha;
+    float beta;
+};
+
+// Drives the renderer along scripted camera paths with fixed orbit states for a fixed number of
+// frames, and reports CPU/GPU frame time statistics as JSON. The first warmupFrames frames are
+// rendered but not measured. A report can be compared against a stored baseline, flagging any
+// statistic that got worse by more than a threshold.
+class FrameBenchmark
+{
+public:
+    FrameBenchmark(int frameCount, int warmupFrames);
+
+    int totalFrames();
+    BenchmarkState state(int frame);
+
+    // gpuMs < 0 means no GPU time was available for this frame
+    void record(int frame, double cpuMs, double gpuMs, unsigned int glCalls, unsigned int redundantGlCalls);
+
+    // Most GL calls made by any measured frame
+    unsigned int maxGlCalls();
+
+    // Adds a per-pass GPU time breakdown to the report (rolling average and maximum)
+    void addGpuScope(const std::string& name, double averageMs, double maxMs);
+
+    // Adds hardware counter results for a CPU region (see perfcounters.h). Negative values mean
+    // the counter wasn't available and are reported as null.
+    void addPerfRegion(const std::string& name, double calls, double elements, double instructionsPerCycle,
+                       double cyclesPerElement, double cacheMissesPerElement, double branchMissesPerElement);
+
+    std::string report();
+    bool writeReport(const std::string& filename);
+
+    // Returns false if any statistic regressed by more than thresholdPercent. A missing baseline
+    // is not a failure; the current results are saved as the new baseline instead.
+    bool compareWithBaseline(const std::string& baselineFilename, double thresholdPercent);
+
+private:
+    struct Statistics
+    {
+        double mean;
+        double p50;
+        double p95;
+        double p99;
+        double max;
+    };
+
+    struct GpuScope
+    {
+        std::string name;
+        double average;
+        double max;
+    };
+
+    struct PerfRegion
+    {
+        std::string name;
+        double calls;
+        double elements;
+        double instructionsPerCycle;
+        double cyclesPerElement;
+        double cacheMissesPerElement;
+        double branchMissesPerElement;
+    };
+
+    static Statistics summarize(std::vector<double> samples);
+
+    int frameCount;
+    int warmupFrames;
+    std::vector<double> cpuTimes;
+    std::vector<double> gpuTimes;
+    double glCallTotal;
+    double redundantGlCallTotal;
+    unsigned int glCallMax;
+    std::vector<GpuScope> gpuScopes;
+    std::vector<PerfRegion> perfRegions;
+};
+
+#endif
@@ -0,0 +1,191 @@
+#include <stdio.h>
+#include <string.h>
+#include "SDL.h"
+
+#include "framepacer.h"
+#include "profiler.h"
+
+const double FramePacer::BUCKET_MS = 0.5;
+
+// Bounds for the spin margin: below the minimum a late wake-up would miss the deadline outright,
+// above the maximum the OS is unreliable enough that spinning longer doesn't help much
+static const double MIN_SPIN_MARGIN_MS = 0.5;
+static const double MAX_SPIN_MARGIN_MS = 4.0;
+
+FramePacer::FramePacer()
+    : pacingMode(VSYNC), targetFramesPerSecond(0.0), frequency(SDL_GetPerformanceFrequency()), framePeriod(0),
+      frameStart(0), deadline(0), workTime(0.0), spinMargin(2.0), frameCount(0), totalFrameTime(0.0),
+      maxFrameTime(0.0), totalWorkTime(0.0), totalSleepTime(0.0), totalSpinTime(0.0), missedDeadlines(0)
+{
+    memset(histogram, 0, sizeof(histogram));
+}
+
+void FramePacer::setMode(Mode mode, double framesPerSecond)
+{
+    pacingMode = mode;
+    targetFramesPerSecond = framesPerSecond;
+    framePeriod = (mode == FIXED_RATE && framesPerSecond > 0.0) ? (uint64_t)(frequency / framesPerSecond) : 0;
+    deadline = 0;
+}
+
+FramePacer::Mode FramePacer::mode() const
+{
+    return pacingMode;
+}
+
+double FramePacer::milliseconds(uint64_t ticks) const
+{
+    return 1000.0 * ticks / frequency;
+}
+
+void FramePacer::beginFrame()
+{
+    uint64_t now = SDL_GetPerformanceCounter();
+    if(frameStart != 0)
+    {
+        double frameTime = milliseconds(now - frameStart);
+        int bucket = (int)(frameTime / BUCKET_MS);
+        histogram[(bucket < HISTOGRAM_BUCKETS) ? bucket : HISTOGRAM_BUCKETS - 1]++;
+        frameCount++;
+        totalFrameTime += frameTime;
+        maxFrameTime = (frameTime > maxFrameTime) ? frameTime : maxFrameTime;
+    }
+    frameStart = now;
+
+    // NOTE: The next deadline follows on from the last one, so frames keep an even cadence. Only
+    //       once a frame has fallen a whole period behind does the schedule restart from now,
+    //       rather than rushing through a burst of frames to catch up.
+    if(framePeriod > 0)
+    {
+        bool onSchedule = (deadline != 0 && now < deadline + framePeriod);
+        deadline = onSchedule ? deadline + framePeriod : now + framePeriod;
+    }
+}
+
+void FramePacer::endFrame()
+{
+    uint64_t now = SDL_GetPerformanceCounter();
+    workTime = milliseconds(now - frameStart);
+    totalWorkTime += workTime;
+
+    if(framePeriod == 0)
+    {
+        return;
+    }
+    if(now >= deadline)
+    {
+        missedDeadlines++;
+        return;
+    }
+    PROFILE_ZONE("frame pacing");
+    waitUntil(deadline);
+}
+
+void FramePacer::waitUntil(uint64_t target)
+{
+    uint64_t now = SDL_GetPerformanceCounter();
+    double remaining = milliseconds(target - now);
+    Uint32 sleepMs = (remaining > spinMargin) ? (Uint32)(remaining - spinMargin) : 0;
+    if(sleepMs == 0)
+    {
+        // Nothing to learn from a frame that only spins, but the margin still has to come back
+        // down after a bad spell or short waits would never sleep again
+        spinMargin = 0.95 * spinMargin;
+        spinMargin = (spinMargin < MIN_SPIN_MARGIN_MS) ? MIN_SPIN_MARGIN_MS : spinMargin;
+    }
+    else
+    {
+        SDL_Delay(sleepMs);
+        uint64_t woke = SDL_GetPerformanceCounter();
+        double slept = milliseconds(woke - now);
+        totalSleepTime += slept;
+
+        // Follow late wake-ups straight away but let the margin shrink back slowly, since one
+        // late wake-up usually means more are coming
+        double late = slept - sleepMs;
+        spinMargin = (late > spinMargin) ? late : 0.95 * spinMargin + 0.05 * late;
+        spinMargin = (spinMargin < MIN_SPIN_MARGIN_MS) ? MIN_SPIN_MARGIN_MS : spinMargin;
+        spinMargin = (spinMargin > MAX_SPIN_MARGIN_MS) ? MAX_SPIN_MARGIN_MS : spinMargin;
+        now = woke;
+    }
+
+    uint64_t spinStart = now;
+    while(now < target)
+    {
+        now = SDL_GetPerformanceCounter();
+    }
+    totalSpinTime += milliseconds(now - spinStart);
+}
+
+void FramePacer::skipFrame()
+{
+    frameStart = 0;
+    deadline = 0;
+}
+
+double FramePacer::lastWorkTime() const
+{
+    return workTime;
+}
+
+void FramePacer::printReport() const
+{
+    if(frameCount == 0)
+    {
+        return;
+    }
+
+    const char* modeNames[] = {"vsync", "fixed rate", "uncapped"};
+    printf("Frame pacing (%s", modeNames[pacingMode]);
+    if(pacingMode == FIXED_RATE)
+    {
+        printf(", %.1f fps", targetFramesPerSecond);
+    }
+    printf("): %llu frames, %.2f ms average, %.2f ms max\n", (unsigned long long)frameCount,
+           totalFrameTime / frameCount, maxFrameTime);
+    printf("  per frame: %.2f ms working, %.2f ms sleeping, %.2f ms spinning; %llu deadlines missed\n",
+           totalWorkTime / frameCount, totalSleepTime / frameCount, totalSpinTime / frameCount,
+           (unsigned long long)missedDeadlines);
+
+    // Percentiles to the nearest bucket
+    double percentiles[3] = {50.0, 95.0, 99.0};
+    double results[3] = {};
+    uint64_t counted = 0;
+    int next = 0;
+    for(int bucket=0; bucket<HISTOGRAM_BUCKETS && next<3; bucket++)
+    {
+        counted += histogram[bucket];
+        while(next < 3 && counted >= percentiles[next] / 100.0 * frameCount)
+        {
+            results[next++] = (bucket + 1) * BUCKET_MS;
+        }
+    }
+    printf("  p50 <= %.1f ms, p95 <= %.1f ms, p99 <= %.1f ms\n", results[0], results[1], results[2]);
+
+    uint64_t largest = 0;
+    for(int bucket=0; bucket<HISTOGRAM_BUCKETS; bucket++)
+    {
+        largest = (histogram[bucket] > largest) ? histogram[bucket] : largest;
+    }
+    for(int bucket=0; bucket<HISTOGRAM_BUCKETS; bucket++)
+    {
+        if(histogram[bucket] == 0)
+        {
+            continue;
+        }
+        char bar[41];
+        int length = (int)(40 * histogram[bucket] / largest);
+        length = (length < 1) ? 1 : length;
+        memset(bar, '#', length);
+        bar[length] = '\0';
+        if(bucket == HISTOGRAM_BUCKETS - 1)
+        {
+            printf("  %5.1f+     ms %-40s %llu\n", bucket * BUCKET_MS, bar, (unsigned long long)histogram[bucket]);
+        }
+        else
+        {
+            printf("  %5.1f-%-5.1f ms %-40s %llu\n", bucket * BUCKET_MS, (bucket + 1) * BUCKET_MS, bar,
+                   (unsigned long long)histogram[bucket]);
+        }
+    }
+}
@@ -0,0 +1,76 @@
+#ifndef FRAME_PACER_H
+#define FRAME_PACER_H
+
+#include <stdint.h>
+
+// Paces the main loop to a target frame time. With vsync the swap already blocks until the next
+// refresh and the pacer only measures; at a fixed rate it waits out whatever is left of each
+// frame's budget after the work is done; uncapped it never waits.
+//
+// Waiting sleeps for most of the remaining time and spins for the rest, since SDL_Delay() only
+// has millisecond granularity and the OS often wakes the thread late. How much is left for
+// spinning adapts to how late the sleeps actually wake up, so the CPU mostly sleeps while frames
+// still start on time. Frames are paced against absolute deadlines, so a late frame doesn't push
+// every later one back.
+//
+// Every frame's length (from one beginFrame() to the next) goes into a histogram of
+// HISTOGRAM_BUCKETS buckets of BUCKET_MS each, the last one collecting everything longer.
+class FramePacer
+{
+public:
+    enum Mode
+    {
+        VSYNC,
+        FIXED_RATE,
+        UNCAPPED
+    };
+
+    static const int HISTOGRAM_BUCKETS = 100;
+    static const double BUCKET_MS;
+
+    FramePacer();
+
+    // framesPerSecond is only used by FIXED_RATE
+    void setMode(Mode mode, double framesPerSecond=0.0);
+    Mode mode() const;
+
+    // Call at the start of every frame, and endFrame() once it has been presented
+    void beginFrame();
+    void endFrame();
+
+    // Drops the frame begun by beginFrame() without recording or pacing it, for loop iterations
+    // that turned out to have nothing to draw. The next frame starts a new schedule.
+    void skipFrame();
+
+    // Milliseconds the last frame spent working (from beginFrame() to endFrame(), before waiting)
+    double lastWorkTime() const;
+
+    // Frame time statistics and the histogram
+    void printReport() const;
+
+private:
+    void waitUntil(uint64_t deadline);
+    double milliseconds(uint64_t ticks) const;
+
+    Mode pacingMode;
+    double targetFramesPerSecond;
+    uint64_t frequency;
+    uint64_t framePeriod;
+    uint64_t frameStart;
+    uint64_t deadline;
+    double workTime;
+
+    // How long before the deadline to stop sleeping and start spinning
+    double spinMargin;
+
+    uint64_t histogram[HISTOGRAM_BUCKETS];
+    uint64_t frameCount;
+    double totalFrameTime;
+    double maxFrameTime;
+    double totalWorkTime;
+    double totalSleepTime;
+    double totalSpinTime;
+    uint64_t missedDeadlines;
+};
+
+#endif
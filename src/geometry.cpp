@@ -4,11 +4,17 @@
 #include <cerrno> // Include for errno
 #include <cstring> // Include for strerror
 
+#include <thread>
+#include <unordered_map>
+
 #include <math.h>
 
 using namespace std;
 
 #include "geometry.h"
+#include "jobsystem.h"
+#include "perfcounters.h"
+#include "profiler.h"
 
 // NOTE: The WaveFront OBJ format spec, states that meshes are allowed to be defined by faces
 //       consisting of 3 or more vertices. For the purposes of this loader (and since this is the
@@ -23,6 +29,52 @@ using namespace std;
 // NOTE: There is currently no support for mtl material references or anything like that,
 //       just load whatever texture you want to use manually
 
+// NOTE: 16 entries is a conservative estimate of the post-transform cache on current GPUs; since
+//       Tipsify only assumes "at least this big", larger caches still benefit from the ordering
+static const int VERTEX_CACHE_SIZE = 16;
+
+// The file is parsed in chunks of about this many bytes, one job each, cut at line ends. OBJ
+// indices are absolute, so every chunk parses on its own and the results are simply appended.
+static const size_t OBJ_CHUNK_BYTES = 256*1024;
+
+// Faces (or vertices) per tangent job
+static const size_t TANGENT_FACES_PER_JOB = 4096;
+
+// A unique combination of position/texture coordinate/normal indices from an OBJ face
+struct VertexKey
+{
+    int vertex;
+    int texCoord;
+    int normal;
+
+    bool operator==(const VertexKey& other) const
+    {
+        return vertex == other.vertex && texCoord == other.texCoord && normal == other.normal;
+    }
+};
+
+struct VertexKeyHash
+{
+    size_t operator()(const VertexKey& key) const
+    {
+        size_t hash = (size_t)key.vertex * 73856093u;
+        hash ^= (size_t)key.texCoord * 19349663u;
+        hash ^= (size_t)key.normal * 83492791u;
+        return hash;
+    }
+};
+
+static void normalize3(float* v)
+{
+    float length = sqrt(v[0]*v[0] + v[1]*v[1] + v[2]*v[2]);
+    if(length > 0.0f)
+    {
+        v[0] /= length;
+        v[1] /= length;
+        v[2] /= length;
+    }
+}
+
 enum OBJDataType
 {
     NONE,
@@ -35,19 +87,27 @@ enum OBJDataType
 
 
 
-void GeometryData::loadFromOBJFile(string filename){
-    
-    GeometryData tempGeom;
+// Everything parsed from one chunk of an OBJ file
+struct OBJChunk
+{
+    vector<float> vertices;
+    vector<float> textureCoords;
+    vector<float> normals;
+    vector<FaceData> faces;
+};
 
-    ifstream inStream;
-    inStream.open(filename, ifstream::in);
-    if(inStream.fail())
+// Lets the stream based parser read straight out of the file contents in memory
+class MemoryBuffer : public streambuf
+{
+public:
+    MemoryBuffer(const char* begin, const char* end)
     {
-        cout << "Unable to open obj file: " << filename << endl;
-        cout << "Error: " << strerror(errno) << endl; // Print out the error message
-        return;
+        setg((char*)begin, (char*)begin, (char*)end);
     }
+};
 
+static void parseOBJChunk(istream& inStream, OBJChunk& chunk)
+{
     OBJDataType currentDataType = NONE;
     while(!inStream.eof())
     {
@@ -109,9 +169,9 @@ void GeometryData::loadFromOBJFile(string filename){
             float y;
             float z;
             inStream >> x >> y >> z;
-            tempGeom.vertices.push_back(x);
-            tempGeom.vertices.push_back(y);
-            tempGeom.vertices.push_back(z);
+            chunk.vertices.push_back(x);
+            chunk.vertices.push_back(y);
+            chunk.vertices.push_back(z);
             currentDataType = COMMENT;
         } break;
 
@@ -120,8 +180,8 @@ void GeometryData::loadFromOBJFile(string filename){
             float u;
             float v;
             inStream >> u >> v;
-            tempGeom.textureCoords.push_back(u);
-            tempGeom.textureCoords.push_back(v);
+            chunk.textureCoords.push_back(u);
+            chunk.textureCoords.push_back(v);
             currentDataType = COMMENT;
         } break;
 
@@ -131,9 +191,9 @@ void GeometryData::loadFromOBJFile(string filename){
             float y;
             float z;
             inStream >> x >> y >> z;
-            tempGeom.normals.push_back(x);
-            tempGeom.normals.push_back(y);
-            tempGeom.normals.push_back(z);
+            chunk.normals.push_back(x);
+            chunk.normals.push_back(y);
+            chunk.normals.push_back(z);
             currentDataType = COMMENT;
         } break;
 
@@ -178,7 +238,7 @@ void GeometryData::loadFromOBJFile(string filename){
                 face.texCoordIndex[index] = texCoordIndex - 1;
                 face.normalIndex[index] = normalIndex - 1;
             }
-            tempGeom.faces.push_back(face);
+            chunk.faces.push_back(face);
             currentDataType = COMMENT;
         } break;
 
@@ -195,15 +255,81 @@ void GeometryData::loadFromOBJFile(string filename){
         {}
         }
     }
+}
+
+void GeometryData::loadFromOBJFile(string filename){
+    PROFILE_ZONE("loadFromOBJFile");
+    GeometryData tempGeom;
+
+    ifstream inStream;
+    inStream.open(filename, ifstream::in | ifstream::binary);
+    if(inStream.fail())
+    {
+        cout << "Unable to open obj file: " << filename << endl;
+        cout << "Error: " << strerror(errno) << endl; // Print out the error message
+        return;
+    }
+    inStream.seekg(0, ios::end);
+    vector<char> contents((size_t)inStream.tellg());
+    inStream.seekg(0, ios::beg);
+    inStream.read(contents.data(), contents.size());
+    inStream.close();
+
+    // NOTE: Counters only follow the calling thread, so with workers the region measures just
+    //       the chunks parsed here, and is given only their faces (run with --jobs 0 to count
+    //       all of them)
+    perfcounters::Region parseRegion("obj parse");
+    thread::id callingThread = this_thread::get_id();
+    size_t facesParsedHere = 0;
+    vector<size_t> chunkStarts(1, 0);
+    while(contents.size() - chunkStarts.back() > OBJ_CHUNK_BYTES)
+    {
+        const char* lineEnd = (const char*)memchr(&contents[chunkStarts.back() + OBJ_CHUNK_BYTES], '\n',
+                                                  contents.size() - chunkStarts.back() - OBJ_CHUNK_BYTES);
+        if(!lineEnd)
+        {
+            break;
+        }
+        chunkStarts.push_back(lineEnd + 1 - contents.data());
+    }
+    chunkStarts.push_back(contents.size());
+
+    vector<OBJChunk> chunks(chunkStarts.size() - 1);
+    jobsystem::parallelFor(chunks.size(), 1, [&](size_t first, size_t last)
+    {
+        for(size_t c=first; c<last; c++)
+        {
+            MemoryBuffer buffer(contents.data() + chunkStarts[c], contents.data() + chunkStarts[c+1]);
+            istream chunkStream(&buffer);
+            parseOBJChunk(chunkStream, chunks[c]);
+            if(this_thread::get_id() == callingThread)
+            {
+                facesParsedHere += chunks[c].faces.size();
+            }
+        }
+    });
+    parseRegion.end(facesParsedHere);
+    for(size_t c=0; c<chunks.size(); c++)
+    {
+        tempGeom.vertices.insert(tempGeom.vertices.end(), chunks[c].vertices.begin(), chunks[c].vertices.end());
+        tempGeom.textureCoords.insert(tempGeom.textureCoords.end(), chunks[c].textureCoords.begin(),
+                                      chunks[c].textureCoords.end());
+        tempGeom.normals.insert(tempGeom.normals.end(), chunks[c].normals.begin(), chunks[c].normals.end());
+        tempGeom.faces.insert(tempGeom.faces.end(), chunks[c].faces.begin(), chunks[c].faces.end());
+    }
 
 
     // NOTE: Since our rendering pipeline supports only 1 set of indices for our data, we need to
-    //       do some post-processing here in order to lay out all the unique v/vt/vn triples
-    // TODO: We're currently just assuming all the triples are distinct, but its probably worth doing
-    //       at least a little bit of checking on that front
+    //       do some post-processing here in order to lay out all the unique v/vt/vn triples.
+    //       Identical triples are merged through a hash map, and each face corner becomes an index
+    //       into the resulting vertex arrays.
     // TODO: We're deciding whether or not to add texture coords and normals on a per-face basis,
     //       which doesn't really make sense because if there are any then there should be for all
     //       vertices, but this way that might not be the case
+    unordered_map<VertexKey, unsigned int, VertexKeyHash> uniqueVertices;
+    uniqueVertices.reserve(tempGeom.faces.size()*3);
+    vector<unsigned int> faceIndices;
+    faceIndices.reserve(tempGeom.faces.size()*3);
     for(int faceIndex=0; faceIndex<tempGeom.faces.size(); faceIndex++)
     {
         FaceData face = tempGeom.faces[faceIndex];
@@ -211,6 +337,20 @@ void GeometryData::loadFromOBJFile(string filename){
         bool hasNormals = (face.normalIndex[0] >= 0);
         for(int vertIndex=0; vertIndex<3; vertIndex++)
         {
+            VertexKey key;
+            key.vertex = face.vertexIndex[vertIndex];
+            key.texCoord = hasTextureCoords ? face.texCoordIndex[vertIndex] : -1;
+            key.normal = hasNormals ? face.normalIndex[vertIndex] : -1;
+
+            unsigned int nextIndex = vertices.size()/3;
+            pair<unordered_map<VertexKey, unsigned int, VertexKeyHash>::iterator, bool> inserted =
+                uniqueVertices.insert(make_pair(key, nextIndex));
+            faceIndices.push_back(inserted.first->second);
+            if(!inserted.second)
+            {
+                continue;
+            }
+
             for(int i=0; i<3; i++)
             {
                 vertices.push_back(tempGeom.vertices[(3*face.vertexIndex[vertIndex])+i]);
@@ -232,66 +372,316 @@ void GeometryData::loadFromOBJFile(string filename){
                 }
             }
         }
+    }
+
+    int uniqueVertexCount = vertices.size()/3;
+    int triangleCount = faceIndices.size()/3;
+    float acmrBefore = simulateVertexCache(faceIndices, uniqueVertexCount, VERTEX_CACHE_SIZE);
+    optimizeTriangleOrder(faceIndices, uniqueVertexCount, VERTEX_CACHE_SIZE);
+    float acmrAfter = simulateVertexCache(faceIndices, uniqueVertexCount, VERTEX_CACHE_SIZE);
+    reorderVertices(faceIndices);
+
+    // Compute the (bi)tangent for each face and accumulate it onto its vertices, so that vertices
+    // shared between faces end up with the (normalized) average
+    if(textureCoords.size()/2 == uniqueVertexCount && normals.size()/3 == uniqueVertexCount)
+    {
+        // NOTE: The face tangents are independent and computed in parallel; adding them onto the
+        //       shared vertices stays sequential, so the sums come out the same on every run
+        vector<float> faceTangents(3*triangleCount);
+        vector<float> faceBitangents(3*triangleCount);
+        jobsystem::parallelFor(triangleCount, TANGENT_FACES_PER_JOB, [&](size_t first, size_t last)
+        {
+            for(size_t triangle=first; triangle<last; triangle++)
+            {
+                const unsigned int* corners = &faceIndices[3*triangle];
+                computeFaceTangent(&vertices[3*corners[0]], &vertices[3*corners[1]], &vertices[3*corners[2]],
+                                   &textureCoords[2*corners[0]], &textureCoords[2*corners[1]],
+                                   &textureCoords[2*corners[2]], &faceTangents[3*triangle],
+                                   &faceBitangents[3*triangle]);
+            }
+        });
 
-        // Compute the (bi)tangent for the face, and add it for each vertex
-        if(hasTextureCoords && hasNormals)
+        tangents.assign(vertices.size(), 0.0f);
+        bitangents.assign(vertices.size(), 0.0f);
+        for(int triangle=0; triangle<triangleCount; triangle++)
         {
-            int vertexStartIndex = vertices.size() - 9;
-            int uvStartIndex = textureCoords.size() - 6;
-            float* vertices = &this->vertices[vertexStartIndex];
-            float* texCoords = &textureCoords[uvStartIndex];
-
-            float deltaX1 = vertices[3] - vertices[0];
-            float deltaY1 = vertices[4] - vertices[1];
-            float deltaZ1 = vertices[5] - vertices[2];
-            float deltaX2 = vertices[6] - vertices[0];
-            float deltaY2 = vertices[7] - vertices[1];
-            float deltaZ2 = vertices[8] - vertices[2];
-
-            float deltaU1 = texCoords[2] - texCoords[0];
-            float deltaV1 = texCoords[3] - texCoords[1];
-            float deltaU2 = texCoords[4] - texCoords[0];
-            float deltaV2 = texCoords[5] - texCoords[1];
-
-            float inverseDet = 1.0f / (deltaU1*deltaV2 - deltaU2*deltaV1);
-
-            float tangentX = inverseDet * (deltaV2*deltaX1 - deltaV1*deltaX2);
-            float tangentY = inverseDet * (deltaV2*deltaY1 - deltaV1*deltaY2);
-            float tangentZ = inverseDet * (deltaV2*deltaZ1 - deltaV1*deltaZ2);
-
-            float bitangentX = inverseDet * (deltaU1*deltaX2 - deltaU2*deltaX1);
-            float bitangentY = inverseDet * (deltaU1*deltaY2 - deltaU2*deltaY1);
-            float bitangentZ = inverseDet * (deltaU1*deltaZ2 - deltaU2*deltaZ1);
-
-            float tangentLength = sqrt(tangentX*tangentX +
-                                       tangentY*tangentY +
-                                       tangentZ*tangentZ);
-            float bitangentLength = sqrt(bitangentX*bitangentX +
-                                         bitangentY*bitangentY +
-                                         bitangentZ*bitangentZ);
-
-            tangentX /= tangentLength;
-            tangentY /= tangentLength;
-            tangentZ /= tangentLength;
-            bitangentX /= bitangentLength;
-            bitangentY /= bitangentLength;
-            bitangentZ /= bitangentLength;
-
-            // NOTE: Each vertex in the face gets the same (bi)tangent pair
+            const unsigned int* corners = &faceIndices[3*triangle];
             for(int vertIndex=0; vertIndex<3; vertIndex++)
             {
-                tangents.push_back(tangentX);
-                tangents.push_back(tangentY);
-                tangents.push_back(tangentZ);
+                for(int i=0; i<3; i++)
+                {
+                    tangents[3*corners[vertIndex]+i] += faceTangents[3*triangle+i];
+                    bitangents[3*corners[vertIndex]+i] += faceBitangents[3*triangle+i];
+                }
+            }
+        }
+
+        jobsystem::parallelFor(uniqueVertexCount, TANGENT_FACES_PER_JOB, [&](size_t first, size_t last)
+        {
+            for(size_t vertex=first; vertex<last; vertex++)
+            {
+                normalize3(&tangents[3*vertex]);
+                normalize3(&bitangents[3*vertex]);
+            }
+        });
+    }
+
+    // Use 16-bit indices whenever they are enough, halving the size of the index buffer
+    if(uniqueVertexCount <= 0xFFFF)
+    {
+        shortIndices.assign(faceIndices.begin(), faceIndices.end());
+    }
+    else
+    {
+        indices.swap(faceIndices);
+    }
+
+    cout << "Successfully loaded an OBJ with " << uniqueVertexCount << " unique vertices from "
+         << 3*triangleCount << " face corners" << endl;
+    cout << "Vertex cache ACMR (" << VERTEX_CACHE_SIZE << " entry FIFO): " << acmrBefore
+         << " before, " << acmrAfter << " after reordering" << endl;
+}
+
+// Computes the normalized tangent and bitangent of the triangle p0/p1/p2 with uvs uv0/uv1/uv2
+void computeFaceTangent(const float* p0, const float* p1, const float* p2,
+                        const float* uv0, const float* uv1, const float* uv2,
+                        float* tangent, float* bitangent)
+{
+    float deltaX1 = p1[0] - p0[0];
+    float deltaY1 = p1[1] - p0[1];
+    float deltaZ1 = p1[2] - p0[2];
+    float deltaX2 = p2[0] - p0[0];
+    float deltaY2 = p2[1] - p0[1];
+    float deltaZ2 = p2[2] - p0[2];
+
+    float deltaU1 = uv1[0] - uv0[0];
+    float deltaV1 = uv1[1] - uv0[1];
+    float deltaU2 = uv2[0] - uv0[0];
+    float deltaV2 = uv2[1] - uv0[1];
+
+    float inverseDet = 1.0f / (deltaU1*deltaV2 - deltaU2*deltaV1);
+
+    tangent[0] = inverseDet * (deltaV2*deltaX1 - deltaV1*deltaX2);
+    tangent[1] = inverseDet * (deltaV2*deltaY1 - deltaV1*deltaY2);
+    tangent[2] = inverseDet * (deltaV2*deltaZ1 - deltaV1*deltaZ2);
+
+    bitangent[0] = inverseDet * (deltaU1*deltaX2 - deltaU2*deltaX1);
+    bitangent[1] = inverseDet * (deltaU1*deltaY2 - deltaU2*deltaY1);
+    bitangent[2] = inverseDet * (deltaU1*deltaZ2 - deltaU2*deltaZ1);
+
+    normalize3(tangent);
+    normalize3(bitangent);
+}
+
+// Average cache miss ratio (vertex shader invocations per triangle) of drawing the triangles in
+// the given order through a FIFO post-transform cache with cacheSize entries
+float simulateVertexCache(const vector<unsigned int>& indices, int vertexCount, int cacheSize)
+{
+    if(indices.empty())
+    {
+        return 0.0f;
+    }
+
+    // NOTE: A vertex is still cached if fewer than cacheSize misses happened since it was loaded
+    vector<int> loadedAt(vertexCount, -cacheSize-1);
+    int misses = 0;
+    for(size_t i=0; i<indices.size(); i++)
+    {
+        unsigned int vertex = indices[i];
+        if(misses - loadedAt[vertex] > cacheSize)
+        {
+            loadedAt[vertex] = misses;
+            misses++;
+        }
+    }
+    return (float)misses / (indices.size()/3);
+}
+
+// Reorders triangles for post-transform vertex cache locality using "Tipsify" (Sander, Nehab and
+// Barczak, "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw", 2007). Triangles
+// are emitted as fans around a sequence of vertices, where the next fan vertex is picked among the
+// ones just emitted as the one that will most likely still be in the cache.
+void optimizeTriangleOrder(vector<unsigned int>& indices, int vertexCount, int cacheSize)
+{
+    PROFILE_ZONE("optimizeTriangleOrder");
+    int triangleCount = indices.size()/3;
+    if(triangleCount == 0)
+    {
+        return;
+    }
+
+    // Triangle adjacency per vertex, stored as one flat array with per-vertex offsets
+    vector<int> liveTriangles(vertexCount, 0);
+    for(size_t i=0; i<indices.size(); i++)
+    {
+        liveTriangles[indices[i]]++;
+    }
+    vector<int> adjacencyOffset(vertexCount+1, 0);
+    for(int vertex=0; vertex<vertexCount; vertex++)
+    {
+        adjacencyOffset[vertex+1] = adjacencyOffset[vertex] + liveTriangles[vertex];
+    }
+    vector<int> adjacency(adjacencyOffset[vertexCount]);
+    vector<int> adjacencyFill(adjacencyOffset.begin(), adjacencyOffset.end()-1);
+    for(int triangle=0; triangle<triangleCount; triangle++)
+    {
+        for(int corner=0; corner<3; corner++)
+        {
+            adjacency[adjacencyFill[indices[3*triangle+corner]]++] = triangle;
+        }
+    }
+
+    vector<int> cacheTime(vertexCount, 0);
+    vector<bool> emitted(triangleCount, false);
+    vector<unsigned int> deadEnds;
+    vector<unsigned int> candidates;
+    vector<unsigned int> output;
+    output.reserve(indices.size());
+
+    int time = cacheSize + 1;
+    int cursor = 1;
+    int fanVertex = 0;
+    while(fanVertex >= 0)
+    {
+        candidates.clear();
+        for(int a=adjacencyOffset[fanVertex]; a<adjacencyOffset[fanVertex+1]; a++)
+        {
+            int triangle = adjacency[a];
+            if(emitted[triangle])
+            {
+                continue;
+            }
+            for(int corner=0; corner<3; corner++)
+            {
+                unsigned int vertex = indices[3*triangle+corner];
+                output.push_back(vertex);
+                deadEnds.push_back(vertex);
+                candidates.push_back(vertex);
+                liveTriangles[vertex]--;
+                if(time - cacheTime[vertex] > cacheSize)
+                {
+                    cacheTime[vertex] = time;
+                    time++;
+                }
+            }
+            emitted[triangle] = true;
+        }
 
-                bitangents.push_back(bitangentX);
-                bitangents.push_back(bitangentY);
-                bitangents.push_back(bitangentZ);
+        // Prefer the candidate that will still be cached after its remaining triangles are
+        // emitted, and among those the one that entered the cache earliest
+        int bestVertex = -1;
+        int bestPriority = -1;
+        for(size_t c=0; c<candidates.size(); c++)
+        {
+            unsigned int vertex = candidates[c];
+            if(liveTriangles[vertex] <= 0)
+            {
+                continue;
+            }
+            int priority = 0;
+            if(time - cacheTime[vertex] + 2*liveTriangles[vertex] <= cacheSize)
+            {
+                priority = time - cacheTime[vertex];
+            }
+            if(priority > bestPriority)
+            {
+                bestPriority = priority;
+                bestVertex = vertex;
             }
         }
+
+        // Dead end: back-track through recently emitted vertices, then fall back to scanning
+        if(bestVertex == -1)
+        {
+            while(!deadEnds.empty() && bestVertex == -1)
+            {
+                unsigned int vertex = deadEnds.back();
+                deadEnds.pop_back();
+                if(liveTriangles[vertex] > 0)
+                {
+                    bestVertex = vertex;
+                }
+            }
+            while(bestVertex == -1 && cursor < vertexCount)
+            {
+                if(liveTriangles[cursor] > 0)
+                {
+                    bestVertex = cursor;
+                }
+                cursor++;
+            }
+        }
+        fanVertex = bestVertex;
     }
 
-    cout << "Successfully loaded an OBJ with " << vertices.size()/3 << " vertices " << endl;
+    indices.swap(output);
+}
+
+// Renumbers the vertices in order of first use, so that vertex fetches walk through memory in the
+// same order as the (already cache optimized) triangles
+void GeometryData::reorderVertices(vector<unsigned int>& faceIndices)
+{
+    int count = vertexCount();
+    vector<int> remap(count, -1);
+    int nextVertex = 0;
+    for(size_t i=0; i<faceIndices.size(); i++)
+    {
+        if(remap[faceIndices[i]] < 0)
+        {
+            remap[faceIndices[i]] = nextVertex++;
+        }
+        faceIndices[i] = remap[faceIndices[i]];
+    }
+
+    vector<float> oldVertices(vertices);
+    vector<float> oldTextureCoords(textureCoords);
+    vector<float> oldNormals(normals);
+    for(int vertex=0; vertex<count; vertex++)
+    {
+        int newVertex = remap[vertex];
+        if(newVertex < 0)
+        {
+            continue;
+        }
+        for(int i=0; i<3; i++)
+        {
+            vertices[3*newVertex+i] = oldVertices[3*vertex+i];
+        }
+        if(oldTextureCoords.size() == 2*(size_t)count)
+        {
+            for(int i=0; i<2; i++)
+            {
+                textureCoords[2*newVertex+i] = oldTextureCoords[2*vertex+i];
+            }
+        }
+        if(oldNormals.size() == 3*(size_t)count)
+        {
+            for(int i=0; i<3; i++)
+            {
+                normals[3*newVertex+i] = oldNormals[3*vertex+i];
+            }
+        }
+    }
+}
+
+void GeometryData::interleavedVertexData(vector<float>& data)
+{
+    perfcounters::Region region("vertex interleave");
+    int count = vertexCount();
+    data.clear();
+    data.reserve(count * 8);
+    for(int j=0; j<count; j++)
+    {
+        data.push_back(vertices[j * 3]);
+        data.push_back(vertices[j * 3 + 1]);
+        data.push_back(vertices[j * 3 + 2]);
+        data.push_back(textureCoords[j * 2]);
+        data.push_back(textureCoords[j * 2 + 1]);
+        data.push_back(normals[j * 3]);
+        data.push_back(normals[j * 3 + 1]);
+        data.push_back(normals[j * 3 + 2]);
+    }
+    region.end(count);
 }
 
 int GeometryData::vertexCount()
@@ -323,3 +713,18 @@ void* GeometryData::bitangentData()
 {
     return (void*)&bitangents[0];
 }
+
+int GeometryData::indexCount()
+{
+    return shortIndices.empty() ? indices.size() : shortIndices.size();
+}
+
+int GeometryData::indexSize()
+{
+    return shortIndices.empty() ? sizeof(unsigned int) : sizeof(unsigned short);
+}
+
+void* GeometryData::indexData()
+{
+    return shortIndices.empty() ? (void*)&indices[0] : (void*)&shortIndices[0];
+}
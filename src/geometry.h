@@ -24,14 +24,34 @@ public:
     void* tangentData();
     void* bitangentData();
 
+    // Position, texture coordinate and normal of each vertex interleaved into data (replacing its
+    // contents), 8 floats per vertex, for uploading the whole mesh as one vertex buffer
+    void interleavedVertexData(std::vector<float>& data);
+
+    // Triangle list indices into the vertex arrays above. indexSize() is 2 (unsigned short) when
+    // there are few enough vertices, otherwise 4 (unsigned int).
+    int indexCount();
+    int indexSize();
+    void* indexData();
+
 private:
+    void reorderVertices(std::vector<unsigned int>& faceIndices);
+
     std::vector<float> vertices;
     std::vector<float> textureCoords;
     std::vector<float> normals;
     std::vector<float> tangents;
     std::vector<float> bitangents;
+    std::vector<unsigned int> indices;
+    std::vector<unsigned short> shortIndices;
 
     std::vector<FaceData> faces;
 };
 
+void computeFaceTangent(const float* p0, const float* p1, const float* p2,
+                        const float* uv0, const float* uv1, const float* uv2,
+                        float* tangent, float* bitangent);
+float simulateVertexCache(const std::vector<unsigned int>& indices, int vertexCount, int cacheSize);
+void optimizeTriangleOrder(std::vector<unsigned int>& indices, int vertexCount, int cacheSize);
+
 #endif
@@ -0,0 +1,176 @@
+#ifdef DEBUG_GL
+
+#include <mutex>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <unordered_map>
+#include "SDL.h"
+
+#include "gldebug.h"
+#include "glhooks.h"
+
+using namespace std;
+
+namespace gldebug
+{
+    struct MessageRecord
+    {
+        unsigned int count;
+        string text;
+    };
+
+    static bool debugActive = false;
+    static mutex messagesMutex;
+
+    // Every distinct message seen so far, keyed by source, type and id
+    static unordered_map<GLuint64, MessageRecord> messages;
+
+    static const char* sourceName(GLenum source)
+    {
+        switch(source)
+        {
+        case GL_DEBUG_SOURCE_API: return "API";
+        case GL_DEBUG_SOURCE_WINDOW_SYSTEM: return "window system";
+        case GL_DEBUG_SOURCE_SHADER_COMPILER: return "shader compiler";
+        case GL_DEBUG_SOURCE_THIRD_PARTY: return "third party";
+        case GL_DEBUG_SOURCE_APPLICATION: return "application";
+        default: return "other";
+        }
+    }
+
+    static const char* typeName(GLenum type)
+    {
+        switch(type)
+        {
+        case GL_DEBUG_TYPE_ERROR: return "error";
+        case GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR: return "deprecated";
+        case GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR: return "undefined behaviour";
+        case GL_DEBUG_TYPE_PORTABILITY: return "portability";
+        case GL_DEBUG_TYPE_PERFORMANCE: return "performance";
+        case GL_DEBUG_TYPE_MARKER: return "marker";
+        default: return "other";
+        }
+    }
+
+    static const char* severityName(GLenum severity)
+    {
+        switch(severity)
+        {
+        case GL_DEBUG_SEVERITY_HIGH: return "HIGH";
+        case GL_DEBUG_SEVERITY_MEDIUM: return "MEDIUM";
+        case GL_DEBUG_SEVERITY_LOW: return "LOW";
+        default: return "NOTE";
+        }
+    }
+
+    // NOTE: Some drivers report the same thing every frame, so after the first occurrence a
+    //       message is only printed again on its 10th, 100th, 1000th, ... repeat
+    static void GLAPIENTRY handleMessage(GLenum source, GLenum type, GLuint id, GLenum severity,
+                                         GLsizei length, const GLchar* message, const void* userParam)
+    {
+        GLuint64 key = ((GLuint64)(source & 0xFFFF) << 48) | ((GLuint64)(type & 0xFFFF) << 32) | id;
+
+        lock_guard<mutex> lock(messagesMutex);
+        MessageRecord& record = messages[key];
+        record.count++;
+        if(record.count == 1)
+        {
+            record.text = string(message, (length >= 0) ? (size_t)length : strlen(message));
+        }
+
+        unsigned int nextReport = 1;
+        while(nextReport < record.count)
+        {
+            nextReport *= 10;
+        }
+        if(nextReport == record.count)
+        {
+            printf("GL %s %s [%s] #%u: %s", sourceName(source), typeName(type), severityName(severity),
+                   id, record.text.c_str());
+            if(record.count > 1)
+            {
+                printf(" (seen %u times)", record.count);
+            }
+            printf("\n");
+        }
+    }
+
+    void requestDebugContext()
+    {
+        SDL_GL_SetAttribute(SDL_GL_CONTEXT_FLAGS, SDL_GL_CONTEXT_DEBUG_FLAG);
+    }
+
+    bool init(GLenum minimumSeverity)
+    {
+        if(!GLEW_KHR_debug && !GLEW_VERSION_4_3)
+        {
+            printf("KHR_debug is not supported, GL errors will only be polled\n");
+            return false;
+        }
+
+        // Synchronous output costs some speed, but means the callback runs inside the offending
+        // GL call, so a breakpoint in handleMessage() shows where it came from
+        glEnable(GL_DEBUG_OUTPUT);
+        glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+        glDebugMessageCallback(handleMessage, NULL);
+
+        const GLenum severities[4] =
+        {
+            GL_DEBUG_SEVERITY_NOTIFICATION, GL_DEBUG_SEVERITY_LOW, GL_DEBUG_SEVERITY_MEDIUM, GL_DEBUG_SEVERITY_HIGH
+        };
+        bool enabled = false;
+        for(int i=0; i<4; i++)
+        {
+            enabled = enabled || (severities[i] == minimumSeverity);
+            glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, severities[i], 0, NULL, enabled ? GL_TRUE : GL_FALSE);
+        }
+
+        debugActive = true;
+        return true;
+    }
+
+    bool active()
+    {
+        return debugActive;
+    }
+
+    void ignoreSource(GLenum source)
+    {
+        if(debugActive)
+        {
+            glDebugMessageControl(source, GL_DONT_CARE, GL_DONT_CARE, 0, NULL, GL_FALSE);
+        }
+    }
+
+    void ignoreMessage(GLenum source, GLenum type, GLuint id)
+    {
+        if(debugActive)
+        {
+            glDebugMessageControl(source, type, GL_DONT_CARE, 1, &id, GL_FALSE);
+        }
+    }
+
+    void label(GLenum identifier, GLuint object, const char* name)
+    {
+        if(debugActive && object != 0)
+        {
+            glObjectLabel(identifier, object, -1, name);
+        }
+    }
+
+    void printSummary()
+    {
+        lock_guard<mutex> lock(messagesMutex);
+        for(unordered_map<GLuint64, MessageRecord>::iterator i=messages.begin(); i!=messages.end(); ++i)
+        {
+            if(i->second.count > 1)
+            {
+                printf("GL debug message #%u was seen %u times: %s\n", (unsigned int)(i->first & 0xFFFFFFFF),
+                       i->second.count, i->second.text.c_str());
+            }
+        }
+    }
+}
+
+#endif
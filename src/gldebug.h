@@ -0,0 +1,46 @@
+#ifndef GL_DEBUG_H
+#define GL_DEBUG_H
+
+#include <GL/glew.h>
+
+// GL error reporting through KHR_debug (core in GL 4.3) rather than by polling glGetError(), which
+// can force the CPU to wait for the GPU every time it's called. The driver calls us back with a
+// message whenever something goes wrong, already saying what, and objects labelled with label()
+// show up in those messages by name instead of by number.
+//
+// Only compiled in for debug builds (make DEBUG=1 defines DEBUG_GL); in release builds every
+// function here is an empty inline, and no debug context is requested.
+namespace gldebug
+{
+#ifdef DEBUG_GL
+    // Must be called before the GL context is created
+    void requestDebugContext();
+
+    // Installs the message callback, if the context supports KHR_debug. Messages less severe than
+    // minimumSeverity are discarded by the driver.
+    bool init(GLenum minimumSeverity=GL_DEBUG_SEVERITY_LOW);
+
+    // True once init() succeeded, in which case polling glGetError() is redundant
+    bool active();
+
+    // Filters out a whole message source, or a single known message
+    void ignoreSource(GLenum source);
+    void ignoreMessage(GLenum source, GLenum type, GLuint id);
+
+    // Names an object (identifier is e.g. GL_TEXTURE, GL_BUFFER, GL_PROGRAM) in debug messages
+    void label(GLenum identifier, GLuint object, const char* name);
+
+    // Lists the messages that were repeated, with how often
+    void printSummary();
+#else
+    inline void requestDebugContext() {}
+    inline bool init(GLenum minimumSeverity=0) { return false; }
+    inline bool active() { return false; }
+    inline void ignoreSource(GLenum source) {}
+    inline void ignoreMessage(GLenum source, GLenum type, GLuint id) {}
+    inline void label(GLenum identifier, GLuint object, const char* name) {}
+    inline void printSummary() {}
+#endif
+}
+
+#endif
@@ -0,0 +1,760 @@
+#include <algorithm>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "glhooks.h"
+
+using namespace std;
+
+namespace glhooks
+{
+    const char* functionNames[FUNCTION_COUNT] =
+    {
+#define GL_HOOK_NAME(name) "gl" #name,
+        GL_HOOK_FUNCTIONS(GL_HOOK_NAME)
+#undef GL_HOOK_NAME
+    };
+
+    unsigned int frameCalls[FUNCTION_COUNT];
+
+    static unsigned int previousFrameCalls[FUNCTION_COUNT];
+    static unsigned int previousFrameTotal;
+    static unsigned int frameRedundantCalls[FUNCTION_COUNT];
+    static unsigned int previousFrameRedundant[FUNCTION_COUNT];
+    static unsigned int previousFrameRedundantTotal;
+
+    // Frame 0 is everything up to the first endFrame()
+    static unsigned int frameNumber;
+
+    // Totals over every frame after the first, for the budget report
+    static unsigned int framesCounted;
+    static unsigned long long totalCalls[FUNCTION_COUNT];
+    static unsigned long long totalRedundant[FUNCTION_COUNT];
+    static unsigned int peakCalls[FUNCTION_COUNT];
+    static unsigned int peakFrameTotal;
+    static unsigned int callBudget;
+    static unsigned int overBudgetFrames;
+
+#ifndef GL_TRACKING_DISABLED
+    static const char* objectTypeNames[OBJECT_TYPE_COUNT] =
+    {
+        "buffers", "textures", "vertex arrays", "framebuffers", "renderbuffers", "programs", "shaders",
+        "queries", "syncs"
+    };
+
+    static const int MAX_TEXTURE_UNITS = 32;
+    static const int MAX_TEXTURE_LEVELS = 16;
+
+    // Live objects of each type, with their estimated size in bytes
+    static unordered_map<GLuint, size_t> objects[OBJECT_TYPE_COUNT];
+    static size_t objectBytes[OBJECT_TYPE_COUNT];
+    static unsigned int peakObjects[OBJECT_TYPE_COUNT];
+    static size_t peakBytes[OBJECT_TYPE_COUNT];
+
+    // Size of every texture level, keyed by texture << 8 | level, so re-specifying a level
+    // replaces its old size
+    static unordered_map<GLuint64, size_t> textureLevels;
+
+    // What the storage calls apply to
+    static unordered_map<GLenum, GLuint> boundBuffers;
+    static unordered_map<GLenum, GLuint> boundTextures[MAX_TEXTURE_UNITS];
+    static int activeTextureUnit;
+    static GLuint boundRenderbuffer;
+
+    static const int MAX_VERTEX_ATTRIBS = 16;
+
+    struct AttribPointer
+    {
+        bool set;
+        GLuint buffer;
+        GLint size;
+        GLenum type;
+        GLboolean normalized;
+        GLsizei stride;
+        const void* pointer;
+    };
+
+    // The state a vertex array object holds: its index buffer and attribute pointers
+    struct VertexArrayState
+    {
+        GLuint elementBuffer;
+        AttribPointer attribs[MAX_VERTEX_ATTRIBS];
+    };
+
+    // The state the redundancy checks compare against. Bindings start out at GL's defaults;
+    // capabilities, uniforms and the stateSet() state are unknown until they're first set, so
+    // the first call setting them never counts as redundant.
+    static unordered_map<GLuint, VertexArrayState> vertexArrays;
+    static GLuint boundVertexArray;
+    static GLuint currentProgram;
+    static unordered_map<GLenum, bool> capabilities;
+    static unordered_map<GLuint64, GLuint> indexedBuffers;
+    static unordered_map<GLuint64, GLuint64> uniformValues;
+    static GLuint lastState[FUNCTION_COUNT][4];
+    static bool stateKnown[FUNCTION_COUNT];
+#endif
+
+    // NOTE: Records are written in the machine's byte order, which is little-endian everywhere
+    //       this runs
+    struct TraceRecord
+    {
+        uint16_t function;
+        uint8_t redundant;
+        uint8_t padding;
+        uint32_t args[4];
+    };
+    static_assert(sizeof(TraceRecord) == 20, "trace records are meant to be 20 bytes");
+
+    static const char TRACE_MAGIC[4] = {'G', 'L', 'T', 'R'};
+    static const uint32_t TRACE_VERSION = 1;
+    static const uint16_t TRACE_FRAME_MARKER = 0xffff;
+    static const int TRACE_BUFFER_RECORDS = 4096;
+
+    static FILE* traceFile;
+    static TraceRecord traceBuffer[TRACE_BUFFER_RECORDS];
+    static int tracedRecords;
+    static int traceFramesLeft;
+
+#ifndef GL_TRACKING_DISABLED
+    static int leakCheckFrames;
+    static int growingFrames;
+    static unsigned int previousLiveTotal;
+
+    static void updatePeaks(ObjectType type)
+    {
+        if(objects[type].size() > peakObjects[type])
+        {
+            peakObjects[type] = (unsigned int)objects[type].size();
+        }
+        if(objectBytes[type] > peakBytes[type])
+        {
+            peakBytes[type] = objectBytes[type];
+        }
+    }
+
+    static void resizeObject(ObjectType type, GLuint object, size_t bytes)
+    {
+        unordered_map<GLuint, size_t>::iterator found = objects[type].find(object);
+        if(found == objects[type].end())
+        {
+            return;
+        }
+        objectBytes[type] += bytes - found->second;
+        found->second = bytes;
+        updatePeaks(type);
+    }
+
+    // Bytes per texel for the uncompressed formats we use; anything else is assumed to be 4
+    static size_t bytesPerTexel(GLenum internalFormat)
+    {
+        switch(internalFormat)
+        {
+        case GL_RED:
+        case GL_R8:
+            return 1;
+        case GL_RG:
+        case GL_RG8:
+        case GL_DEPTH_COMPONENT16:
+            return 2;
+        case GL_RGB:
+        case GL_RGB8:
+            return 3;
+        case GL_RGBA16F:
+            return 8;
+        case GL_RGBA32F:
+            return 16;
+        default:
+            return 4;
+        }
+    }
+#endif
+
+    static void flushTrace()
+    {
+        fwrite(traceBuffer, sizeof(TraceRecord), tracedRecords, traceFile);
+        tracedRecords = 0;
+    }
+
+    static void trace(uint16_t function, bool redundant, GLuint a, GLuint b, GLuint c, GLuint d)
+    {
+        if(tracedRecords == TRACE_BUFFER_RECORDS)
+        {
+            flushTrace();
+        }
+        TraceRecord& record = traceBuffer[tracedRecords++];
+        record.function = function;
+        record.redundant = redundant ? 1 : 0;
+        record.padding = 0;
+        record.args[0] = a;
+        record.args[1] = b;
+        record.args[2] = c;
+        record.args[3] = d;
+    }
+
+#ifndef GL_TRACKING_DISABLED
+    // Every tracked state change ends up here
+    static void stateCall(Function function, bool redundant, GLuint a, GLuint b=0, GLuint c=0, GLuint d=0)
+    {
+        if(redundant)
+        {
+            frameRedundantCalls[function]++;
+        }
+        if(traceFile)
+        {
+            trace((uint16_t)function, redundant, a, b, c, d);
+        }
+    }
+
+    void objectsCreated(ObjectType type, GLsizei count, const GLuint* created)
+    {
+        for(GLsizei i=0; i<count; i++)
+        {
+            objectCreated(type, created[i]);
+        }
+    }
+
+    void objectsDeleted(ObjectType type, GLsizei count, const GLuint* deleted)
+    {
+        for(GLsizei i=0; i<count; i++)
+        {
+            objectDeleted(type, deleted[i]);
+        }
+    }
+
+    GLuint objectCreated(ObjectType type, GLuint object)
+    {
+        if(object != 0)
+        {
+            objects[type][object] = 0;
+            updatePeaks(type);
+        }
+        return object;
+    }
+
+    void objectDeleted(ObjectType type, GLuint object)
+    {
+        unordered_map<GLuint, size_t>::iterator found = objects[type].find(object);
+        if(object == 0 || found == objects[type].end())
+        {
+            return;
+        }
+        objectBytes[type] -= found->second;
+        objects[type].erase(found);
+
+        // Deleting a bound object unbinds it
+        if(type == TEXTURE_OBJECT)
+        {
+            for(int level=0; level<MAX_TEXTURE_LEVELS; level++)
+            {
+                textureLevels.erase(((GLuint64)object << 8) | level);
+            }
+            for(int unit=0; unit<MAX_TEXTURE_UNITS; unit++)
+            {
+                for(unordered_map<GLenum, GLuint>::iterator i=boundTextures[unit].begin(); i!=boundTextures[unit].end(); ++i)
+                {
+                    i->second = (i->second == object) ? 0 : i->second;
+                }
+            }
+        }
+        else if(type == BUFFER_OBJECT)
+        {
+            for(unordered_map<GLenum, GLuint>::iterator i=boundBuffers.begin(); i!=boundBuffers.end(); ++i)
+            {
+                i->second = (i->second == object) ? 0 : i->second;
+            }
+        }
+        else if(type == RENDERBUFFER_OBJECT && boundRenderbuffer == object)
+        {
+            boundRenderbuffer = 0;
+        }
+        else if(type == VERTEX_ARRAY_OBJECT)
+        {
+            vertexArrays.erase(object);
+            boundVertexArray = (boundVertexArray == object) ? 0 : boundVertexArray;
+        }
+        else if(type == FRAMEBUFFER_OBJECT)
+        {
+            stateKnown[BindFramebuffer] = false;
+        }
+        else if(type == PROGRAM_OBJECT)
+        {
+            // A new program may reuse the name, with its uniforms back at their defaults
+            for(unordered_map<GLuint64, GLuint64>::iterator i=uniformValues.begin(); i!=uniformValues.end();)
+            {
+                i = ((GLuint)(i->first >> 32) == object) ? uniformValues.erase(i) : ++i;
+            }
+        }
+    }
+
+    // NOTE: GLsync is a pointer rather than a name, so syncs are only counted, keyed by the
+    //       lower bits of their address
+    GLsync syncCreated(GLsync sync)
+    {
+        objectCreated(SYNC_OBJECT, (GLuint)(size_t)sync);
+        return sync;
+    }
+
+    void syncDeleted(GLsync sync)
+    {
+        objectDeleted(SYNC_OBJECT, (GLuint)(size_t)sync);
+    }
+
+    void activeTextureChanged(GLenum unit)
+    {
+        int index = (int)(unit - GL_TEXTURE0);
+        index = (index >= 0 && index < MAX_TEXTURE_UNITS) ? index : 0;
+        stateCall(ActiveTexture, index == activeTextureUnit, unit);
+        activeTextureUnit = index;
+    }
+
+    void bufferBound(GLenum target, GLuint buffer)
+    {
+        // NOTE: The index buffer binding is part of the vertex array object's state
+        bool redundant;
+        if(target == GL_ELEMENT_ARRAY_BUFFER)
+        {
+            GLuint& elementBuffer = vertexArrays[boundVertexArray].elementBuffer;
+            redundant = (elementBuffer == buffer);
+            elementBuffer = buffer;
+        }
+        else
+        {
+            unordered_map<GLenum, GLuint>::iterator found = boundBuffers.find(target);
+            redundant = (found != boundBuffers.end() && found->second == buffer);
+        }
+        boundBuffers[target] = buffer;
+        stateCall(BindBuffer, redundant, target, buffer);
+    }
+
+    void textureBound(GLenum target, GLuint texture)
+    {
+        unordered_map<GLenum, GLuint>::iterator found = boundTextures[activeTextureUnit].find(target);
+        bool redundant = (found != boundTextures[activeTextureUnit].end() && found->second == texture);
+        boundTextures[activeTextureUnit][target] = texture;
+        stateCall(BindTexture, redundant, target, texture, activeTextureUnit);
+    }
+
+    void renderbufferBound(GLuint renderbuffer)
+    {
+        boundRenderbuffer = renderbuffer;
+    }
+
+    void stateSet(Function function, GLuint a, GLuint b, GLuint c, GLuint d)
+    {
+        GLuint* last = lastState[function];
+        bool redundant = stateKnown[function] && last[0] == a && last[1] == b && last[2] == c && last[3] == d;
+        last[0] = a;
+        last[1] = b;
+        last[2] = c;
+        last[3] = d;
+        stateKnown[function] = true;
+        stateCall(function, redundant, a, b, c, d);
+    }
+
+    void capabilitySet(GLenum capability, bool enabled)
+    {
+        unordered_map<GLenum, bool>::iterator found = capabilities.find(capability);
+        bool redundant = (found != capabilities.end() && found->second == enabled);
+        capabilities[capability] = enabled;
+        stateCall(enabled ? Enable : Disable, redundant, capability);
+    }
+
+    void vertexArrayBound(GLuint vertexArray)
+    {
+        bool redundant = (vertexArray == boundVertexArray);
+        boundVertexArray = vertexArray;
+        boundBuffers[GL_ELEMENT_ARRAY_BUFFER] = vertexArrays[vertexArray].elementBuffer;
+        stateCall(BindVertexArray, redundant, vertexArray);
+    }
+
+    void programUsed(GLuint program)
+    {
+        bool redundant = (program == currentProgram);
+        currentProgram = program;
+        stateCall(UseProgram, redundant, program);
+    }
+
+    void bufferBaseBound(GLenum target, GLuint index, GLuint buffer)
+    {
+        // Binding to an indexed target binds the generic target as well
+        boundBuffers[target] = buffer;
+        GLuint64 key = ((GLuint64)target << 32) | index;
+        unordered_map<GLuint64, GLuint>::iterator found = indexedBuffers.find(key);
+        bool redundant = (found != indexedBuffers.end() && found->second == buffer);
+        indexedBuffers[key] = buffer;
+        stateCall(BindBufferBase, redundant, target, index, buffer);
+    }
+
+    void attribPointerSet(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride,
+                          const void* pointer)
+    {
+        if(index >= (GLuint)MAX_VERTEX_ATTRIBS)
+        {
+            return;
+        }
+        // The pointer is an offset into whatever is bound to GL_ARRAY_BUFFER at the time
+        GLuint buffer = boundBuffers[GL_ARRAY_BUFFER];
+        AttribPointer& attrib = vertexArrays[boundVertexArray].attribs[index];
+        bool redundant = attrib.set && attrib.buffer == buffer && attrib.size == size && attrib.type == type &&
+                         attrib.normalized == normalized && attrib.stride == stride && attrib.pointer == pointer;
+        attrib.set = true;
+        attrib.buffer = buffer;
+        attrib.size = size;
+        attrib.type = type;
+        attrib.normalized = normalized;
+        attrib.stride = stride;
+        attrib.pointer = pointer;
+        stateCall(VertexAttribPointer, redundant, index, buffer, (GLuint)stride, (GLuint)(size_t)pointer);
+    }
+
+    // NOTE: Setting a uniform at location -1 is silently ignored by GL, so it's always redundant
+    void uniformSet(Function function, GLint location, GLuint x, GLuint y)
+    {
+        bool redundant = (location == -1);
+        if(location != -1)
+        {
+            GLuint64 key = ((GLuint64)currentProgram << 32) | (GLuint)location;
+            GLuint64 value = ((GLuint64)y << 32) | x;
+            unordered_map<GLuint64, GLuint64>::iterator found = uniformValues.find(key);
+            redundant = (found != uniformValues.end() && found->second == value);
+            uniformValues[key] = value;
+        }
+        stateCall(function, redundant, (GLuint)location, x, y, currentProgram);
+    }
+
+    void drawCall(Function function, GLenum mode, GLsizei count, GLsizei instances)
+    {
+        if(traceFile)
+        {
+            trace((uint16_t)function, false, mode, (GLuint)count, (GLuint)instances, currentProgram);
+        }
+    }
+
+    void bufferStorage(GLenum target, GLsizeiptr size)
+    {
+        resizeObject(BUFFER_OBJECT, boundBuffers[target], (size_t)size);
+    }
+
+    void textureStorage(GLenum target, GLint level, GLenum internalFormat, GLsizei width, GLsizei height,
+                        GLsizei depth, GLsizei compressedSize)
+    {
+        GLuint texture = boundTextures[activeTextureUnit][target];
+        unordered_map<GLuint, size_t>::iterator found = objects[TEXTURE_OBJECT].find(texture);
+        if(found == objects[TEXTURE_OBJECT].end() || level < 0 || level >= MAX_TEXTURE_LEVELS)
+        {
+            return;
+        }
+
+        size_t bytes = compressedSize ? (size_t)compressedSize :
+                                        (size_t)width * height * depth * bytesPerTexel(internalFormat);
+        size_t& levelBytes = textureLevels[((GLuint64)texture << 8) | level];
+        resizeObject(TEXTURE_OBJECT, texture, found->second - levelBytes + bytes);
+        levelBytes = bytes;
+    }
+
+    void renderbufferStorage(GLenum internalFormat, GLsizei width, GLsizei height)
+    {
+        resizeObject(RENDERBUFFER_OBJECT, boundRenderbuffer, (size_t)width * height * bytesPerTexel(internalFormat));
+    }
+
+    unsigned int liveObjects(ObjectType type)
+    {
+        return (unsigned int)objects[type].size();
+    }
+
+    size_t liveBytes(ObjectType type)
+    {
+        return objectBytes[type];
+    }
+
+    void printObjectReport()
+    {
+        printf("Live GL objects:\n");
+        for(int type=0; type<OBJECT_TYPE_COUNT; type++)
+        {
+            printf("  %-14s %5u live (%8.2f MB), peak %5u (%8.2f MB)\n", objectTypeNames[type],
+                   (unsigned int)objects[type].size(), objectBytes[type] / (1024.0 * 1024.0),
+                   peakObjects[type], peakBytes[type] / (1024.0 * 1024.0));
+
+            // Name the first few survivors, which is usually enough to tell where they came from
+            int listed = 0;
+            for(unordered_map<GLuint, size_t>::iterator i=objects[type].begin();
+                i!=objects[type].end() && listed<8; ++i, listed++)
+            {
+                printf("      #%u: %zu bytes\n", i->first, i->second);
+            }
+        }
+    }
+
+    void setLeakCheck(int frameCount)
+    {
+        leakCheckFrames = frameCount;
+        growingFrames = 0;
+    }
+#else
+    unsigned int liveObjects(ObjectType type)
+    {
+        return 0;
+    }
+
+    size_t liveBytes(ObjectType type)
+    {
+        return 0;
+    }
+
+    void printObjectReport()
+    {
+    }
+
+    void setLeakCheck(int frameCount)
+    {
+        if(frameCount > 0)
+        {
+            printf("GL object tracking is compiled out (build with GL_TRACKING=1), no leak check\n");
+        }
+    }
+#endif
+
+    void endFrame()
+    {
+#ifndef GL_TRACKING_DISABLED
+        if(leakCheckFrames > 0)
+        {
+            unsigned int liveTotal = 0;
+            for(int type=0; type<OBJECT_TYPE_COUNT; type++)
+            {
+                liveTotal += (unsigned int)objects[type].size();
+            }
+            growingFrames = (liveTotal > previousLiveTotal) ? growingFrames + 1 : 0;
+            previousLiveTotal = liveTotal;
+            if(growingFrames >= leakCheckFrames)
+            {
+                printf("GL objects grew on %d frames in a row, probably leaking:\n", growingFrames);
+                printObjectReport();
+                abort();
+            }
+        }
+#endif
+
+        previousFrameTotal = 0;
+        previousFrameRedundantTotal = 0;
+        for(int i=0; i<FUNCTION_COUNT; i++)
+        {
+            previousFrameTotal += frameCalls[i];
+            previousFrameRedundantTotal += frameRedundantCalls[i];
+        }
+
+        // NOTE: The first frame also holds all of the setup, which would swamp the peaks, so
+        //       it's left out of the budget
+        if(frameNumber > 0)
+        {
+            framesCounted++;
+            for(int i=0; i<FUNCTION_COUNT; i++)
+            {
+                totalCalls[i] += frameCalls[i];
+                totalRedundant[i] += frameRedundantCalls[i];
+                peakCalls[i] = (frameCalls[i] > peakCalls[i]) ? frameCalls[i] : peakCalls[i];
+            }
+            peakFrameTotal = (previousFrameTotal > peakFrameTotal) ? previousFrameTotal : peakFrameTotal;
+            if(callBudget > 0 && previousFrameTotal > callBudget)
+            {
+                overBudgetFrames++;
+            }
+        }
+
+        memcpy(previousFrameCalls, frameCalls, sizeof(frameCalls));
+        memset(frameCalls, 0, sizeof(frameCalls));
+        memcpy(previousFrameRedundant, frameRedundantCalls, sizeof(frameRedundantCalls));
+        memset(frameRedundantCalls, 0, sizeof(frameRedundantCalls));
+        frameNumber++;
+
+        if(traceFile)
+        {
+            if(traceFramesLeft == 0)
+            {
+                stopTrace();
+            }
+            else
+            {
+                traceFramesLeft--;
+                trace(TRACE_FRAME_MARKER, false, frameNumber, 0, 0, 0);
+            }
+        }
+    }
+
+    unsigned int lastFrameCallCount()
+    {
+        return previousFrameTotal;
+    }
+
+    unsigned int lastFrameCalls(Function function)
+    {
+        return previousFrameCalls[function];
+    }
+
+    unsigned int lastFrameRedundantCount()
+    {
+        return previousFrameRedundantTotal;
+    }
+
+    unsigned int lastFrameRedundantCalls(Function function)
+    {
+        return previousFrameRedundant[function];
+    }
+
+    bool startTrace(const char* filename, int frameCount)
+    {
+#ifdef GL_TRACKING_DISABLED
+        printf("GL state tracking is compiled out (build with GL_TRACKING=1), no trace written\n");
+        return false;
+#else
+        stopTrace();
+        traceFile = fopen(filename, "wb");
+        if(!traceFile)
+        {
+            printf("Unable to write GL trace: %s\n", filename);
+            return false;
+        }
+
+        uint32_t header[2] = {TRACE_VERSION, FUNCTION_COUNT};
+        fwrite(TRACE_MAGIC, 1, sizeof(TRACE_MAGIC), traceFile);
+        fwrite(header, sizeof(uint32_t), 2, traceFile);
+        for(int i=0; i<FUNCTION_COUNT; i++)
+        {
+            uint8_t length = (uint8_t)strlen(functionNames[i]);
+            fwrite(&length, 1, 1, traceFile);
+            fwrite(functionNames[i], 1, length, traceFile);
+        }
+
+        tracedRecords = 0;
+        traceFramesLeft = frameCount;
+        trace(TRACE_FRAME_MARKER, false, frameNumber, 0, 0, 0);
+        return true;
+#endif
+    }
+
+    void stopTrace()
+    {
+        if(!traceFile)
+        {
+            return;
+        }
+        flushTrace();
+        fclose(traceFile);
+        traceFile = NULL;
+    }
+
+    bool dumpTrace(const char* filename)
+    {
+        FILE* file = fopen(filename, "rb");
+        if(!file)
+        {
+            printf("Unable to open GL trace: %s\n", filename);
+            return false;
+        }
+
+        char magic[4];
+        uint32_t header[2];
+        if(fread(magic, 1, sizeof(magic), file) != sizeof(magic) || memcmp(magic, TRACE_MAGIC, sizeof(magic)) != 0 ||
+           fread(header, sizeof(uint32_t), 2, file) != 2 || header[0] != TRACE_VERSION)
+        {
+            printf("%s is not a GL trace (or was written by another version)\n", filename);
+            fclose(file);
+            return false;
+        }
+
+        vector<string> names(header[1]);
+        for(size_t i=0; i<names.size(); i++)
+        {
+            uint8_t length = 0;
+            char name[256];
+            if(fread(&length, 1, 1, file) != 1 || fread(name, 1, length, file) != length)
+            {
+                printf("%s is truncated\n", filename);
+                fclose(file);
+                return false;
+            }
+            names[i].assign(name, length);
+        }
+
+        unsigned long long records = 0;
+        unsigned long long redundant = 0;
+        unsigned int frames = 0;
+        TraceRecord record;
+        while(fread(&record, sizeof(record), 1, file) == 1)
+        {
+            if(record.function == TRACE_FRAME_MARKER)
+            {
+                printf("frame %u\n", record.args[0]);
+                frames++;
+                continue;
+            }
+            printf("  %-26s 0x%-6x 0x%-6x 0x%-6x 0x%-6x%s\n",
+                   (record.function < names.size()) ? names[record.function].c_str() : "(unknown)",
+                   record.args[0], record.args[1], record.args[2], record.args[3],
+                   record.redundant ? "  redundant" : "");
+            records++;
+            redundant += record.redundant;
+        }
+        printf("%llu calls over %u frames, %llu redundant\n", records, frames, redundant);
+        fclose(file);
+        return true;
+    }
+
+    void setCallBudget(unsigned int callsPerFrame)
+    {
+        callBudget = callsPerFrame;
+        overBudgetFrames = 0;
+    }
+
+    unsigned int framesOverBudget()
+    {
+        return overBudgetFrames;
+    }
+
+    unsigned int peakFrameCallCount()
+    {
+        return peakFrameTotal;
+    }
+
+    void printBudgetReport()
+    {
+        if(framesCounted == 0)
+        {
+            return;
+        }
+
+        unsigned long long calls = 0;
+        unsigned long long redundant = 0;
+        vector<int> called;
+        for(int i=0; i<FUNCTION_COUNT; i++)
+        {
+            calls += totalCalls[i];
+            redundant += totalRedundant[i];
+            if(totalCalls[i] > 0)
+            {
+                called.push_back(i);
+            }
+        }
+        sort(called.begin(), called.end(), [](int a, int b) { return totalCalls[a] > totalCalls[b]; });
+
+        printf("GL calls per frame over %u frames: %.1f average, %u peak, %.1f redundant\n", framesCounted,
+               (double)calls / framesCounted, peakFrameTotal, (double)redundant / framesCounted);
+        if(callBudget > 0)
+        {
+            printf("  budget %u calls per frame, exceeded on %u frames\n", callBudget, overBudgetFrames);
+        }
+        printf("  %-26s %9s %6s %10s\n", "function", "average", "peak", "redundant");
+        for(size_t i=0; i<called.size(); i++)
+        {
+            int function = called[i];
+            printf("  %-26s %9.2f %6u %9.1f%%\n", functionNames[function], (double)totalCalls[function] / framesCounted,
+                   peakCalls[function], 100.0 * totalRedundant[function] / totalCalls[function]);
+        }
+    }
+}
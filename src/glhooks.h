@@ -0,0 +1,371 @@
+#ifndef GL_HOOKS_H
+#define GL_HOOKS_H
+
+// Thin wrappers over the GL entry points the renderer uses. Include this after <GL/glew.h> in
+// every file that makes GL calls: each wrapped function is redefined as a macro that records the
+// call before forwarding it to the real entry point, which lets us count GL calls per frame
+// without touching the call sites.
+//
+// NOTE: A function that is not listed here still works, it just isn't counted. When adding a
+//       new GL call to the renderer, add it to GL_HOOK_FUNCTIONS and to the macros below.
+//
+// The hooks on object creation/deletion, binding and storage allocation also keep track of every
+// live GL object and roughly how much memory it holds, so that leaks show up in the report
+// printed at shutdown (or, with setLeakCheck(), as soon as live objects keep piling up) rather
+// than when the driver finally runs out of memory.
+//
+// The hooks on state-setting calls (binds, enables, vertex attribute pointers, uniforms and a few
+// fixed-function settings) also remember the state they set, so calls that set it to what it
+// already was are counted as redundant. Those calls and every draw can be written to a compact
+// binary trace (startTrace()), and the per-function counts add up to a per-frame budget report.
+//
+// Building with -DGL_TRACKING_DISABLED (make GL_TRACKING=0) compiles the object and state
+// tracking out of every hook, leaving only the call counters: object reports, leak checks, GL
+// traces and redundant call counts are then unavailable (and read as zero).
+
+#include <GL/glew.h>
+#include <string.h>
+
+#define GL_HOOK_FUNCTIONS(X) \
+    X(ActiveTexture) X(AttachShader) X(BindBuffer) X(BindBufferBase) X(BindFramebuffer) \
+    X(BindRenderbuffer) X(BindTexture) X(BindVertexArray) X(CheckFramebufferStatus) X(BlendFunc) X(BufferData) X(BufferSubData) X(Clear) X(ClearColor) \
+    X(ClientWaitSync) X(CompileShader) X(CompressedTexImage3D) X(CompressedTexSubImage3D) \
+    X(CreateProgram) X(CreateShader) X(CullFace) X(DebugMessageCallback) X(DebugMessageControl) X(DeleteBuffers) \
+    X(DeleteFramebuffers) X(DeleteProgram) X(DeleteQueries) X(DeleteRenderbuffers) X(DeleteShader) X(DeleteSync) X(DeleteTextures) X(DeleteVertexArrays) \
+    X(Disable) X(DrawArrays) X(DrawElementsInstanced) X(Enable) X(EnableVertexAttribArray) X(FenceSync) X(FramebufferRenderbuffer) X(Finish) \
+    X(GenBuffers) X(GenFramebuffers) X(GenQueries) X(GenRenderbuffers) X(GenTextures) X(GenVertexArrays) X(GetError) X(GetIntegerv) X(GetProgramBinary) \
+    X(GetProgramInfoLog) X(GetProgramiv) X(GetQueryObjectiv) X(GetQueryObjectui64v) X(GetShaderInfoLog) X(GetShaderiv) X(GetString) \
+    X(GetUniformBlockIndex) X(GetUniformLocation) X(LinkProgram) X(MapBufferRange) X(ObjectLabel) \
+    X(PixelStorei) X(ProgramBinary) X(ProgramParameteri) X(QueryCounter) X(ReadPixels) X(RenderbufferStorage) X(ShaderSource) X(TexImage2D) X(TexImage3D) \
+    X(TexParameteri) X(TexSubImage2D) X(TexSubImage3D) X(Uniform1i) X(Uniform2f) X(UniformBlockBinding) X(UnmapBuffer) X(UseProgram) \
+    X(VertexAttribDivisor) X(VertexAttribPointer) X(Viewport)
+
+namespace glhooks
+{
+    enum Function
+    {
+#define GL_HOOK_ENUM(name) name,
+        GL_HOOK_FUNCTIONS(GL_HOOK_ENUM)
+#undef GL_HOOK_ENUM
+        FUNCTION_COUNT
+    };
+
+    extern const char* functionNames[FUNCTION_COUNT];
+
+    // Calls made since the last endFrame(), per function
+    extern unsigned int frameCalls[FUNCTION_COUNT];
+
+    inline void record(Function function)
+    {
+        frameCalls[function]++;
+    }
+
+    // Closes the current frame's counts (available through the lastFrame* functions below) and
+    // starts counting a new frame. Called once a frame has been drawn, so that right after it the
+    // lastFrame* functions describe the frame that was just drawn.
+    void endFrame();
+
+    unsigned int lastFrameCallCount();
+    unsigned int lastFrameCalls(Function function);
+
+    // Calls in the last frame that only set state to the value it already had
+    unsigned int lastFrameRedundantCount();
+    unsigned int lastFrameRedundantCalls(Function function);
+
+    // Called by the macros below. Each one checks the call against the state it last set and
+    // counts (and traces) the call as redundant if nothing changed. stateSet() is for calls that
+    // set a single piece of state per function, like glBlendFunc; float arguments are passed as
+    // their bits (floatBits()) so that equal values compare equal.
+    void stateSet(Function function, GLuint a, GLuint b=0, GLuint c=0, GLuint d=0);
+    void capabilitySet(GLenum capability, bool enabled);
+    void vertexArrayBound(GLuint vertexArray);
+    void programUsed(GLuint program);
+    void bufferBaseBound(GLenum target, GLuint index, GLuint buffer);
+    void attribPointerSet(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride,
+                          const void* pointer);
+    void uniformSet(Function function, GLint location, GLuint x, GLuint y=0);
+    void drawCall(Function function, GLenum mode, GLsizei count, GLsizei instances);
+
+    inline GLuint floatBits(GLfloat value)
+    {
+        GLuint bits;
+        memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+
+    // Writes every tracked state change and draw call to filename, for the rest of the current
+    // frame and the next frameCount frames. The file starts with "GLTR", a version, the number of
+    // functions and their names (a length byte each, then the characters), followed by 20 byte
+    // records: the function (0xffff marks the start of a frame), a redundant flag, a padding byte
+    // and four 32-bit arguments. dumpTrace() prints one as text.
+    bool startTrace(const char* filename, int frameCount);
+    void stopTrace();
+    bool dumpTrace(const char* filename);
+
+    // Counts the frames that made more than callsPerFrame GL calls. 0 (the default) turns the
+    // budget off.
+    void setCallBudget(unsigned int callsPerFrame);
+    unsigned int framesOverBudget();
+    unsigned int peakFrameCallCount();
+
+    // Average and peak calls per frame for each function that was called, with the redundant
+    // share, over every frame closed by endFrame() after the first one (which holds the setup)
+    void printBudgetReport();
+
+    enum ObjectType
+    {
+        BUFFER_OBJECT,
+        TEXTURE_OBJECT,
+        VERTEX_ARRAY_OBJECT,
+        FRAMEBUFFER_OBJECT,
+        RENDERBUFFER_OBJECT,
+        PROGRAM_OBJECT,
+        SHADER_OBJECT,
+        QUERY_OBJECT,
+        SYNC_OBJECT,
+        OBJECT_TYPE_COUNT
+    };
+
+    // Called by the macros below; objectCreated() and syncCreated() pass the new object through
+    void objectsCreated(ObjectType type, GLsizei count, const GLuint* objects);
+    void objectsDeleted(ObjectType type, GLsizei count, const GLuint* objects);
+    GLuint objectCreated(ObjectType type, GLuint object);
+    void objectDeleted(ObjectType type, GLuint object);
+    GLsync syncCreated(GLsync sync);
+    void syncDeleted(GLsync sync);
+    void activeTextureChanged(GLenum unit);
+    void bufferBound(GLenum target, GLuint buffer);
+    void textureBound(GLenum target, GLuint texture);
+    void renderbufferBound(GLuint renderbuffer);
+    void bufferStorage(GLenum target, GLsizeiptr size);
+    void textureStorage(GLenum target, GLint level, GLenum internalFormat, GLsizei width, GLsizei height,
+                        GLsizei depth, GLsizei compressedSize=0);
+    void renderbufferStorage(GLenum internalFormat, GLsizei width, GLsizei height);
+
+    unsigned int liveObjects(ObjectType type);
+    size_t liveBytes(ObjectType type);
+
+    // Lists live objects per type with their estimated sizes, plus the peaks over the whole run
+    void printObjectReport();
+
+    // Prints the report and aborts once the number of live objects has grown on frameCount
+    // consecutive frames. 0 (the default) turns the check off.
+    void setLeakCheck(int frameCount);
+}
+
+// GL 1.0/1.1 functions are exported directly by libGL. Since a macro is not expanded again inside
+// its own replacement, the inner call still refers to the real function.
+#define GL_HOOK_CORE(name, ...) (glhooks::record(glhooks::name), gl##name(__VA_ARGS__))
+
+// Everything newer goes through GLEW's function pointers
+#define GL_HOOK_EXT(name, ...) (glhooks::record(glhooks::name), GLEW_GET_FUN(__glew##name)(__VA_ARGS__))
+
+#ifndef GL_TRACKING_DISABLED
+#define GL_TRACK(call) glhooks::call
+#define GL_TRACK_CREATED(type, object) glhooks::objectCreated(glhooks::type, object)
+#define GL_TRACK_SYNC(sync) glhooks::syncCreated(sync)
+#else
+#define GL_TRACK(call) ((void)0)
+#define GL_TRACK_CREATED(type, object) (object)
+#define GL_TRACK_SYNC(sync) (sync)
+#endif
+
+// NOTE: The tracking macros below name their arguments since they pass them on to the tracker as
+//       well, which evaluates them twice. Every call site passes plain variables, constants or
+//       arithmetic on them; nothing with side effects (or another GL call).
+#define glBindTexture(target, texture) \
+    (GL_HOOK_CORE(BindTexture, target, texture), GL_TRACK(textureBound(target, texture)))
+#define glBlendFunc(source, destination) \
+    (GL_HOOK_CORE(BlendFunc, source, destination), GL_TRACK(stateSet(glhooks::BlendFunc, source, destination)))
+#define glClear(...) GL_HOOK_CORE(Clear, __VA_ARGS__)
+#define glClearColor(red, green, blue, alpha) \
+    (GL_HOOK_CORE(ClearColor, red, green, blue, alpha), GL_TRACK(stateSet(glhooks::ClearColor, \
+     glhooks::floatBits(red), glhooks::floatBits(green), glhooks::floatBits(blue), glhooks::floatBits(alpha))))
+#define glCullFace(mode) \
+    (GL_HOOK_CORE(CullFace, mode), GL_TRACK(stateSet(glhooks::CullFace, mode)))
+#define glDeleteTextures(count, textures) \
+    (GL_TRACK(objectsDeleted(glhooks::TEXTURE_OBJECT, count, textures)), GL_HOOK_CORE(DeleteTextures, count, textures))
+#define glDisable(capability) \
+    (GL_HOOK_CORE(Disable, capability), GL_TRACK(capabilitySet(capability, false)))
+#define glDrawArrays(mode, first, count) \
+    (GL_HOOK_CORE(DrawArrays, mode, first, count), GL_TRACK(drawCall(glhooks::DrawArrays, mode, count, 1)))
+#define glEnable(capability) \
+    (GL_HOOK_CORE(Enable, capability), GL_TRACK(capabilitySet(capability, true)))
+#define glFinish(...) GL_HOOK_CORE(Finish, __VA_ARGS__)
+#define glGenTextures(count, textures) \
+    (GL_HOOK_CORE(GenTextures, count, textures), GL_TRACK(objectsCreated(glhooks::TEXTURE_OBJECT, count, textures)))
+#define glGetError(...) GL_HOOK_CORE(GetError, __VA_ARGS__)
+#define glGetIntegerv(...) GL_HOOK_CORE(GetIntegerv, __VA_ARGS__)
+#define glGetString(...) GL_HOOK_CORE(GetString, __VA_ARGS__)
+#define glPixelStorei(name, value) \
+    (GL_HOOK_CORE(PixelStorei, name, value), GL_TRACK(stateSet(glhooks::PixelStorei, name, value)))
+#define glReadPixels(...) GL_HOOK_CORE(ReadPixels, __VA_ARGS__)
+#define glTexImage2D(target, level, internalFormat, width, height, border, format, type, pixels) \
+    (GL_HOOK_CORE(TexImage2D, target, level, internalFormat, width, height, border, format, type, pixels), \
+     GL_TRACK(textureStorage(target, level, internalFormat, width, height, 1)))
+#define glTexParameteri(...) GL_HOOK_CORE(TexParameteri, __VA_ARGS__)
+#define glTexSubImage2D(...) GL_HOOK_CORE(TexSubImage2D, __VA_ARGS__)
+#define glViewport(x, y, width, height) \
+    (GL_HOOK_CORE(Viewport, x, y, width, height), GL_TRACK(stateSet(glhooks::Viewport, x, y, width, height)))
+
+#undef glActiveTexture
+#define glActiveTexture(unit) \
+    (GL_HOOK_EXT(ActiveTexture, unit), GL_TRACK(activeTextureChanged(unit)))
+#undef glAttachShader
+#define glAttachShader(...) GL_HOOK_EXT(AttachShader, __VA_ARGS__)
+#undef glBindBuffer
+#define glBindBuffer(target, buffer) \
+    (GL_HOOK_EXT(BindBuffer, target, buffer), GL_TRACK(bufferBound(target, buffer)))
+#undef glBindBufferBase
+#define glBindBufferBase(target, index, buffer) \
+    (GL_HOOK_EXT(BindBufferBase, target, index, buffer), GL_TRACK(bufferBaseBound(target, index, buffer)))
+#undef glBindFramebuffer
+#define glBindFramebuffer(target, framebuffer) \
+    (GL_HOOK_EXT(BindFramebuffer, target, framebuffer), GL_TRACK(stateSet(glhooks::BindFramebuffer, target, framebuffer)))
+#undef glBindRenderbuffer
+#define glBindRenderbuffer(target, renderbuffer) \
+    (GL_HOOK_EXT(BindRenderbuffer, target, renderbuffer), GL_TRACK(renderbufferBound(renderbuffer)))
+#undef glBindVertexArray
+#define glBindVertexArray(vertexArray) \
+    (GL_HOOK_EXT(BindVertexArray, vertexArray), GL_TRACK(vertexArrayBound(vertexArray)))
+#undef glBufferData
+#define glBufferData(target, size, data, usage) \
+    (GL_HOOK_EXT(BufferData, target, size, data, usage), GL_TRACK(bufferStorage(target, size)))
+#undef glBufferSubData
+#define glBufferSubData(...) GL_HOOK_EXT(BufferSubData, __VA_ARGS__)
+#undef glCheckFramebufferStatus
+#define glCheckFramebufferStatus(...) GL_HOOK_EXT(CheckFramebufferStatus, __VA_ARGS__)
+#undef glClientWaitSync
+#define glClientWaitSync(...) GL_HOOK_EXT(ClientWaitSync, __VA_ARGS__)
+#undef glCompileShader
+#define glCompileShader(...) GL_HOOK_EXT(CompileShader, __VA_ARGS__)
+#undef glCompressedTexImage3D
+#define glCompressedTexImage3D(target, level, internalFormat, width, height, depth, border, size, data) \
+    (GL_HOOK_EXT(CompressedTexImage3D, target, level, internalFormat, width, height, depth, border, size, data), \
+     GL_TRACK(textureStorage(target, level, internalFormat, width, height, depth, size)))
+#undef glCompressedTexSubImage3D
+#define glCompressedTexSubImage3D(...) GL_HOOK_EXT(CompressedTexSubImage3D, __VA_ARGS__)
+#undef glCreateProgram
+#define glCreateProgram() \
+    GL_TRACK_CREATED(PROGRAM_OBJECT, GL_HOOK_EXT(CreateProgram))
+#undef glCreateShader
+#define glCreateShader(type) \
+    GL_TRACK_CREATED(SHADER_OBJECT, GL_HOOK_EXT(CreateShader, type))
+#undef glDebugMessageCallback
+#define glDebugMessageCallback(...) GL_HOOK_EXT(DebugMessageCallback, __VA_ARGS__)
+#undef glDebugMessageControl
+#define glDebugMessageControl(...) GL_HOOK_EXT(DebugMessageControl, __VA_ARGS__)
+#undef glDeleteBuffers
+#define glDeleteBuffers(count, objects) \
+    (GL_TRACK(objectsDeleted(glhooks::BUFFER_OBJECT, count, objects)), GL_HOOK_EXT(DeleteBuffers, count, objects))
+#undef glDeleteFramebuffers
+#define glDeleteFramebuffers(count, objects) \
+    (GL_TRACK(objectsDeleted(glhooks::FRAMEBUFFER_OBJECT, count, objects)), GL_HOOK_EXT(DeleteFramebuffers, count, objects))
+#undef glDeleteProgram
+#define glDeleteProgram(program) \
+    (GL_TRACK(objectDeleted(glhooks::PROGRAM_OBJECT, program)), GL_HOOK_EXT(DeleteProgram, program))
+#undef glDeleteQueries
+#define glDeleteQueries(count, objects) \
+    (GL_TRACK(objectsDeleted(glhooks::QUERY_OBJECT, count, objects)), GL_HOOK_EXT(DeleteQueries, count, objects))
+#undef glDeleteRenderbuffers
+#define glDeleteRenderbuffers(count, objects) \
+    (GL_TRACK(objectsDeleted(glhooks::RENDERBUFFER_OBJECT, count, objects)), GL_HOOK_EXT(DeleteRenderbuffers, count, objects))
+#undef glDeleteShader
+#define glDeleteShader(shader) \
+    (GL_TRACK(objectDeleted(glhooks::SHADER_OBJECT, shader)), GL_HOOK_EXT(DeleteShader, shader))
+#undef glDeleteSync
+#define glDeleteSync(sync) \
+    (GL_TRACK(syncDeleted(sync)), GL_HOOK_EXT(DeleteSync, sync))
+#undef glDeleteVertexArrays
+#define glDeleteVertexArrays(count, objects) \
+    (GL_TRACK(objectsDeleted(glhooks::VERTEX_ARRAY_OBJECT, count, objects)), GL_HOOK_EXT(DeleteVertexArrays, count, objects))
+#undef glDrawElementsInstanced
+#define glDrawElementsInstanced(mode, count, type, indices, instances) \
+    (GL_HOOK_EXT(DrawElementsInstanced, mode, count, type, indices, instances), \
+     GL_TRACK(drawCall(glhooks::DrawElementsInstanced, mode, count, instances)))
+#undef glEnableVertexAttribArray
+#define glEnableVertexAttribArray(...) GL_HOOK_EXT(EnableVertexAttribArray, __VA_ARGS__)
+#undef glFenceSync
+#define glFenceSync(condition, flags) \
+    GL_TRACK_SYNC(GL_HOOK_EXT(FenceSync, condition, flags))
+#undef glFramebufferRenderbuffer
+#define glFramebufferRenderbuffer(...) GL_HOOK_EXT(FramebufferRenderbuffer, __VA_ARGS__)
+#undef glGenBuffers
+#define glGenBuffers(count, objects) \
+    (GL_HOOK_EXT(GenBuffers, count, objects), GL_TRACK(objectsCreated(glhooks::BUFFER_OBJECT, count, objects)))
+#undef glGenFramebuffers
+#define glGenFramebuffers(count, objects) \
+    (GL_HOOK_EXT(GenFramebuffers, count, objects), GL_TRACK(objectsCreated(glhooks::FRAMEBUFFER_OBJECT, count, objects)))
+#undef glGenQueries
+#define glGenQueries(count, objects) \
+    (GL_HOOK_EXT(GenQueries, count, objects), GL_TRACK(objectsCreated(glhooks::QUERY_OBJECT, count, objects)))
+#undef glGenRenderbuffers
+#define glGenRenderbuffers(count, objects) \
+    (GL_HOOK_EXT(GenRenderbuffers, count, objects), GL_TRACK(objectsCreated(glhooks::RENDERBUFFER_OBJECT, count, objects)))
+#undef glGenVertexArrays
+#define glGenVertexArrays(count, objects) \
+    (GL_HOOK_EXT(GenVertexArrays, count, objects), GL_TRACK(objectsCreated(glhooks::VERTEX_ARRAY_OBJECT, count, objects)))
+#undef glGetProgramBinary
+#define glGetProgramBinary(...) GL_HOOK_EXT(GetProgramBinary, __VA_ARGS__)
+#undef glGetProgramInfoLog
+#define glGetProgramInfoLog(...) GL_HOOK_EXT(GetProgramInfoLog, __VA_ARGS__)
+#undef glGetProgramiv
+#define glGetProgramiv(...) GL_HOOK_EXT(GetProgramiv, __VA_ARGS__)
+#undef glGetQueryObjectiv
+#define glGetQueryObjectiv(...) GL_HOOK_EXT(GetQueryObjectiv, __VA_ARGS__)
+#undef glGetQueryObjectui64v
+#define glGetQueryObjectui64v(...) GL_HOOK_EXT(GetQueryObjectui64v, __VA_ARGS__)
+#undef glGetShaderInfoLog
+#define glGetShaderInfoLog(...) GL_HOOK_EXT(GetShaderInfoLog, __VA_ARGS__)
+#undef glGetShaderiv
+#define glGetShaderiv(...) GL_HOOK_EXT(GetShaderiv, __VA_ARGS__)
+#undef glGetUniformBlockIndex
+#define glGetUniformBlockIndex(...) GL_HOOK_EXT(GetUniformBlockIndex, __VA_ARGS__)
+#undef glGetUniformLocation
+#define glGetUniformLocation(...) GL_HOOK_EXT(GetUniformLocation, __VA_ARGS__)
+#undef glLinkProgram
+#define glLinkProgram(...) GL_HOOK_EXT(LinkProgram, __VA_ARGS__)
+#undef glMapBufferRange
+#define glMapBufferRange(...) GL_HOOK_EXT(MapBufferRange, __VA_ARGS__)
+#undef glObjectLabel
+#define glObjectLabel(...) GL_HOOK_EXT(ObjectLabel, __VA_ARGS__)
+#undef glProgramBinary
+#define glProgramBinary(...) GL_HOOK_EXT(ProgramBinary, __VA_ARGS__)
+#undef glProgramParameteri
+#define glProgramParameteri(...) GL_HOOK_EXT(ProgramParameteri, __VA_ARGS__)
+#undef glQueryCounter
+#define glQueryCounter(...) GL_HOOK_EXT(QueryCounter, __VA_ARGS__)
+#undef glRenderbufferStorage
+#define glRenderbufferStorage(target, internalFormat, width, height) \
+    (GL_HOOK_EXT(RenderbufferStorage, target, internalFormat, width, height), \
+     GL_TRACK(renderbufferStorage(internalFormat, width, height)))
+#undef glShaderSource
+#define glShaderSource(...) GL_HOOK_EXT(ShaderSource, __VA_ARGS__)
+#undef glTexImage3D
+#define glTexImage3D(target, level, internalFormat, width, height, depth, border, format, type, pixels) \
+    (GL_HOOK_EXT(TexImage3D, target, level, internalFormat, width, height, depth, border, format, type, pixels), \
+     GL_TRACK(textureStorage(target, level, internalFormat, width, height, depth)))
+#undef glTexSubImage3D
+#define glTexSubImage3D(...) GL_HOOK_EXT(TexSubImage3D, __VA_ARGS__)
+#undef glUniform1i
+#define glUniform1i(location, x) \
+    (GL_HOOK_EXT(Uniform1i, location, x), GL_TRACK(uniformSet(glhooks::Uniform1i, location, (GLuint)(x))))
+#undef glUniform2f
+#define glUniform2f(location, x, y) \
+    (GL_HOOK_EXT(Uniform2f, location, x, y), \
+     GL_TRACK(uniformSet(glhooks::Uniform2f, location, glhooks::floatBits(x), glhooks::floatBits(y))))
+#undef glUniformBlockBinding
+#define glUniformBlockBinding(...) GL_HOOK_EXT(UniformBlockBinding, __VA_ARGS__)
+#undef glUnmapBuffer
+#define glUnmapBuffer(...) GL_HOOK_EXT(UnmapBuffer, __VA_ARGS__)
+#undef glUseProgram
+#define glUseProgram(program) \
+    (GL_HOOK_EXT(UseProgram, program), GL_TRACK(programUsed(program)))
+#undef glVertexAttribDivisor
+#define glVertexAttribDivisor(...) GL_HOOK_EXT(VertexAttribDivisor, __VA_ARGS__)
+#undef glVertexAttribPointer
+#define glVertexAttribPointer(index, size, type, normalized, stride, pointer) \
+    (GL_HOOK_EXT(VertexAttribPointer, index, size, type, normalized, stride, pointer), \
+     GL_TRACK(attribPointerSet(index, size, type, normalized, stride, pointer)))
+
+#endif
@@ -2,13 +2,18 @@
 #include <stdio.h>
 #include <glm/gtc/type_ptr.hpp>
 #include "SDL.h"
-#include "stb_image.h"
 #include <GL/glew.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include "glwindow.h"
+#include "gldebug.h"
+#include "glhooks.h"
+#include "jobsystem.h"
+#include "perfcounters.h"
+#include "profiler.h"
 #include "geometry.h"
 #include <math.h>
+#include <stddef.h>
 
 using namespace std;
 
@@ -35,99 +40,92 @@ const char* glGetErrorString(GLenum error)
     }
 }
 
+// NOTE: glGetError() can stall until the GPU catches up, so this only polls in debug builds, and
+//       only when the driver can't report errors through the debug callback instead
 void glPrintError(const char* label="Unlabelled Error Checkpoint", bool alwaysPrint=false)
 {
+#ifdef DEBUG_GL
+    if(gldebug::active())
+    {
+        return;
+    }
     GLenum error = glGetError();
     if(alwaysPrint || (error != GL_NO_ERROR))
     {
         printf("%s: OpenGL error flag is %s\n", label, glGetErrorString(error));
     }
+#endif
 }
 
-GLuint loadShader(const char* shaderFilename, GLenum shaderType)
+WindowSettings::WindowSettings()
+    : headless(false), width(640), height(480), vsync(true), waitForTextures(false), showHud(false)
 {
-    FILE* shaderFile = fopen(shaderFilename, "r");
-    if(!shaderFile)
-    {
-        return 0;
-    }
-
-    fseek(shaderFile, 0, SEEK_END);
-    long shaderSize = ftell(shaderFile);
-    fseek(shaderFile, 0, SEEK_SET);
-
-    char* shaderText = new char[shaderSize+1];
-    size_t readCount = fread(shaderText, 1, shaderSize, shaderFile);
-    shaderText[readCount] = '\0';
-    fclose(shaderFile);
-
-    GLuint shader = glCreateShader(shaderType);
-    glShaderSource(shader, 1, (const char**)&shaderText, NULL);
-    glCompileShader(shader);
-
-    delete[] shaderText;
-
-    return shader;
 }
 
-GLuint loadShaderProgram(const char* vertShaderFilename,
-                       const char* fragShaderFilename)
+OpenGLWindow::OpenGLWindow()
+    : sdlWin(NULL), glContext(NULL), framebuffer(0), colorRenderbuffer(0), depthRenderbuffer(0),
+      frameIndex(0), vao(0), shader(0), vertexBuffer(0), elementBuffer(0),
+      vertexCount(0), indexCount(0), indexType(GL_UNSIGNED_INT), instanceBuffer(0), instanceCapacity(0),
+      frameUniformBuffer(0), materialUniformBuffer(0), textureLocation(-1), alphaIncrement(0.0f),
+      betaIncrement(0.0f), currentZoom(0.0f), frameTriangles(0), cpuFrameTime(0.0), lastTitleUpdate(0)
 {
-    GLuint vertShader = loadShader(vertShaderFilename, GL_VERTEX_SHADER);
-    GLuint fragShader = loadShader(fragShaderFilename, GL_FRAGMENT_SHADER);
-
-    GLuint program = glCreateProgram();
-    glAttachShader(program, vertShader);
-    glAttachShader(program, fragShader);
-    glLinkProgram(program);
-    glDeleteShader(vertShader);
-    glDeleteShader(fragShader);
-
-    GLint linkStatus;
-    glGetProgramiv(program, GL_LINK_STATUS, &linkStatus);
-    if(linkStatus != GL_TRUE)
+    for(int i=0; i<BODY_TEXTURE_COUNT; i++)
     {
-        GLsizei logLength = 0;
-        GLchar message[1024];
-        glGetProgramInfoLog(program, 1024, &logLength, message);
-        cout << "Shader load error: " << message << endl;
-        return 0;
+        textureHandles[i] = 0;
     }
-
-    return program;
 }
 
-OpenGLWindow::OpenGLWindow()
-{
-}
 
-
-void OpenGLWindow::initGL()
+void OpenGLWindow::initGL(const WindowSettings& settings)
 {
+    this->settings = settings;
+
     // We need to first specify what type of OpenGL context we need before we can create the window
     SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
     SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
-    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 2);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
     SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
+    gldebug::requestDebugContext();
 
+    // NOTE: In headless mode the window only exists to own the GL context; everything is drawn
+    //       into an offscreen framebuffer, so its size doesn't matter
+    Uint32 windowFlags = SDL_WINDOW_OPENGL | (settings.headless ? SDL_WINDOW_HIDDEN : 0);
+    int windowWidth = settings.headless ? 64 : settings.width;
+    int windowHeight = settings.headless ? 64 : settings.height;
     sdlWin = SDL_CreateWindow("OpenGL Prac 1",
                               SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
-                              640, 480, SDL_WINDOW_OPENGL);
+                              windowWidth, windowHeight, windowFlags);
     if(!sdlWin)
     {
-        SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_INFORMATION, "Error", "Unable to create window", 0);
+        if(settings.headless)
+        {
+            cout << "Unable to create window: " << SDL_GetError() << endl;
+        }
+        else
+        {
+            SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_INFORMATION, "Error", "Unable to create window", 0);
+        }
     }
-    SDL_GLContext glc = SDL_GL_CreateContext(sdlWin);
-    SDL_GL_MakeCurrent(sdlWin, glc);
-    SDL_GL_SetSwapInterval(1);
+    glContext = SDL_GL_CreateContext(sdlWin);
+    SDL_GL_MakeCurrent(sdlWin, glContext);
+    SDL_GL_SetSwapInterval(settings.vsync ? 1 : 0);
 
     glewExperimental = true;
     GLenum glewInitResult = glewInit();
     glGetError(); // Consume the error erroneously set by glewInit()
     if(glewInitResult != GLEW_OK)
     {
+        // NOTE: Under EGL (e.g. SDL's offscreen driver) there is no GLX display, which GLEW reports
+        //       as an error even though it has already loaded every GL entry point
         const GLubyte* errorString = glewGetErrorString(glewInitResult);
-        cout << "Unable to initialize glew: " << errorString;
+        if(GLEW_VERSION_3_3)
+        {
+            cout << "glew reported \"" << errorString << "\", continuing since GL 3.3 is available" << endl;
+        }
+        else
+        {
+            cout << "Unable to initialize glew: " << errorString;
+        }
     }
 
     int glMajorVersion;
@@ -140,166 +138,476 @@ void OpenGLWindow::initGL()
     cout << "\tVersion: " << glGetString(GL_VERSION) << endl;
     cout << "\tGLSL Version: " << glGetString(GL_SHADING_LANGUAGE_VERSION) << endl;
 
+    gldebug::init();
+
     glEnable(GL_DEPTH_TEST);
     glEnable(GL_CULL_FACE);
     glCullFace(GL_BACK);
     glClearColor(0,0,0,1);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    // NOTE: Everything below is created exactly once here and released in cleanup(), so that
+    //       render() only has to update uniforms and issue draws
+
+    glGenVertexArrays(1, &vao);
+    glBindVertexArray(vao);
+    gldebug::label(GL_VERTEX_ARRAY, vao, "sphere");
+
+    shaderCache.init("shadercache");
+    shader = shaderCache.loadProgram("simple.vert", "simple.frag");
+    glUseProgram(shader);
+    gldebug::label(GL_PROGRAM, shader, "simple");
+    cout << "Shader cache: " << shaderCache.hitCount() << " hit(s), "
+         << shaderCache.missCount() << " miss(es)" << endl;
+
+    initUniforms();
 
     // Load the model that we want to use and buffer the vertex attributes
-    geometry.loadFromOBJFile("sphere-fixed.obj");    
+    geometry.loadFromOBJFile("sphere-fixed.obj");
+    vertexCount = geometry.vertexCount();
+
+    // Interleave position/uv/normal so that a single buffer holds the whole mesh
+    std::vector<float> combinedData;
+    geometry.interleavedVertexData(combinedData);
+
+    glGenBuffers(1, &vertexBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+    gldebug::label(GL_BUFFER, vertexBuffer, "sphere vertices");
+    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * combinedData.size(), combinedData.data(), GL_STATIC_DRAW);
+
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3* sizeof(float)));
+    glEnableVertexAttribArray(1);
+
+    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(5 * sizeof(float)));
+    glEnableVertexAttribArray(2);
+
+    // The element buffer binding is part of the VAO state, so this only has to happen once
+    indexCount = geometry.indexCount();
+    indexType = (geometry.indexSize() == 2) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    glGenBuffers(1, &elementBuffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, elementBuffer);
+    gldebug::label(GL_BUFFER, elementBuffer, "sphere indices");
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, geometry.indexSize() * indexCount, geometry.indexData(), GL_STATIC_DRAW);
+
+    // Per-instance attributes: the model matrix takes up locations 3-6 (one per column), and the
+    // texture layer location 7. They are pointed at the right slice of the buffer when drawing.
+    glGenBuffers(1, &instanceBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+    gldebug::label(GL_BUFFER, instanceBuffer, "body instances");
+    for (int location = 3; location <= 7; location++)
+    {
+        glEnableVertexAttribArray(location);
+        glVertexAttribDivisor(location, 1);
+    }
+
+    loadTextures();
+
+    // The HUD has its own program and vertex array, so switch back to the scene's afterwards
+    hud.init(shaderCache);
+    if(settings.showHud)
+    {
+        hud.toggle();
+    }
+    glUseProgram(shader);
+    glBindVertexArray(vao);
+
+    if(settings.headless)
+    {
+        initFramebuffer();
+    }
 
-    
+    // NOTE: Captured and benchmarked frames are meant to be reproducible, so don't let any of them
+    //       show the placeholder textures
+    while((settings.waitForTextures || !settings.captureDirectory.empty()) && textureStreamer.busy())
+    {
+        textureStreamer.update();
+        SDL_Delay(1);
+    }
+    glViewport(0, 0, settings.width, settings.height);
+
+    // Timer queries are core since GL 3.3
+    profiler.init();
+
+    glPrintError("Setup complete");
 }
 
-void OpenGLWindow::render(float a, float b, float theta, float phi, float zoom)
+// Creates the offscreen colour/depth target that headless mode renders into. It stays bound, so
+// render() draws into it exactly like it would into the window.
+void OpenGLWindow::initFramebuffer()
 {
+    glGenRenderbuffers(1, &colorRenderbuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, colorRenderbuffer);
+    gldebug::label(GL_RENDERBUFFER, colorRenderbuffer, "offscreen colour");
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, settings.width, settings.height);
+
+    glGenRenderbuffers(1, &depthRenderbuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, depthRenderbuffer);
+    gldebug::label(GL_RENDERBUFFER, depthRenderbuffer, "offscreen depth");
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, settings.width, settings.height);
+
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    gldebug::label(GL_FRAMEBUFFER, framebuffer, "offscreen");
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorRenderbuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthRenderbuffer);
+    if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        cout << "Offscreen framebuffer is incomplete" << endl;
+    }
 
-    glGenVertexArrays(1, &vao);
-    glBindVertexArray(vao);    
+    cout << "Rendering headless into a " << settings.width << "x" << settings.height << " framebuffer" << endl;
+}
 
-    shader = loadShaderProgram("simple.vert", "simple.frag");
-    glUseProgram(shader);
+// Reads back the frame that was just drawn and writes it out as a binary PPM
+void OpenGLWindow::captureFrame()
+{
+    int width = settings.width;
+    int height = settings.height;
+    capturePixels.resize((size_t)width * height * 3);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, capturePixels.data());
+
+    char filename[512];
+    snprintf(filename, sizeof(filename), "%s/frame_%05d.ppm", settings.captureDirectory.c_str(), frameIndex);
+    FILE* file = fopen(filename, "wb");
+    if(!file)
+    {
+        cout << "Unable to write " << filename << endl;
+        return;
+    }
+
+    // NOTE: GL rows start at the bottom of the image, PPM rows at the top
+    fprintf(file, "P6\n%d %d\n255\n", width, height);
+    for(int y=height-1; y>=0; y--)
+    {
+        fwrite(&capturePixels[(size_t)y * width * 3], 1, (size_t)width * 3, file);
+    }
+    fclose(file);
+}
+
+// Sets up the uniform blocks and resolves the locations of the remaining plain uniforms. This is
+// the only place uniform names are looked up; render() just updates the frame block.
+void OpenGLWindow::initUniforms()
+{
+    GLuint frameBlock = glGetUniformBlockIndex(shader, "FrameData");
+    GLuint materialBlock = glGetUniformBlockIndex(shader, "MaterialData");
+    glUniformBlockBinding(shader, frameBlock, FRAME_UNIFORM_BINDING);
+    glUniformBlockBinding(shader, materialBlock, MATERIAL_UNIFORM_BINDING);
+
+    textureLocation = glGetUniformLocation(shader, "Texture");
+    glUniform1i(textureLocation, 0);
+
+    glGenBuffers(1, &frameUniformBuffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, frameUniformBuffer);
+    gldebug::label(GL_BUFFER, frameUniformBuffer, "FrameData");
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameUniforms), NULL, GL_STREAM_DRAW);
+    glBindBufferBase(GL_UNIFORM_BUFFER, FRAME_UNIFORM_BINDING, frameUniformBuffer);
+
+    // The material never changes, so it is written once and left alone
+    MaterialUniforms material;
+    material.ambient = glm::vec4(1.0f, 0.5f, 0.31f, 0.0f);
+    material.diffuse = glm::vec4(1.0f, 0.5f, 0.31f, 0.0f);
+    material.specular = glm::vec4(0.5f, 0.5f, 0.5f, 0.0f);
+    material.shininess = 32.0f;
+    glGenBuffers(1, &materialUniformBuffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, materialUniformBuffer);
+    gldebug::label(GL_BUFFER, materialUniformBuffer, "MaterialData");
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(MaterialUniforms), &material, GL_STATIC_DRAW);
+    glBindBufferBase(GL_UNIFORM_BUFFER, MATERIAL_UNIFORM_BINDING, materialUniformBuffer);
+}
+
+void OpenGLWindow::loadTextures()
+{
+    // NOTE: This only queues the textures; they are decoded by background jobs and uploaded a
+    //       little at a time from render(), with a placeholder drawn until each one is resident
+    const char* images[BODY_TEXTURE_COUNT] = {"sun_texture.png", "earth_diffuse.png", "moon_diffuse.png"};
+    // NOTE: The layer size matches the sun texture, and the earth and moon textures are within a
+    //       few percent of it, so packing them costs next to no detail. The bodies are opaque, so
+    //       BC1 is enough and takes an eighth of the memory of RGBA8.
+    textureStreamer.init("texcache", 2048, 1536, BODY_TEXTURE_COUNT, TEXTURE_BC1);
+    for (int i = 0; i < BODY_TEXTURE_COUNT; i++){
+        textureHandles[i] = textureStreamer.request(images[i]);
+    }
+}
+
+// GPU profiler scope names for the instanced draws. Bodies are drawn one batch per texture object,
+// so with layer packing all of them usually end up in "bodies batch 0".
+static const char* BATCH_SCOPE_NAMES[BODY_TEXTURE_COUNT] =
+{
+    "bodies batch 0", "bodies batch 1", "bodies batch 2"
+};
+
+// Draws every body with one instanced draw per texture object. Once every body texture is resident
+// they all live in the streamer's layer array, so that is a single draw call; while textures are
+// still streaming (or for textures too different to share the array) there is one extra draw per
+// texture object. Instances are bucketed with a counting sort, so the number of draw calls never
+// depends on the number of bodies.
+void OpenGLWindow::drawBodies()
+{
+    // Work out which texture object and layer each body texture maps to right now
+    GLuint batchTextures[BODY_TEXTURE_COUNT];
+    int batchOf[BODY_TEXTURE_COUNT];
+    int layerOf[BODY_TEXTURE_COUNT];
+    int batchCount = 0;
+    for (int t = 0; t < BODY_TEXTURE_COUNT; t++)
+    {
+        GLuint texture;
+        textureStreamer.binding(textureHandles[t], texture, layerOf[t]);
+        int batch = 0;
+        while (batch < batchCount && batchTextures[batch] != texture)
+        {
+            batch++;
+        }
+        if (batch == batchCount)
+        {
+            batchTextures[batchCount++] = texture;
+        }
+        batchOf[t] = batch;
+    }
+
+    int batchStart[BODY_TEXTURE_COUNT+1] = {};
+    for (size_t i = 0; i < bodies.size(); i++)
+    {
+        batchStart[batchOf[bodies[i].texture] + 1]++;
+    }
+    for (int batch = 0; batch < batchCount; batch++)
+    {
+        batchStart[batch + 1] += batchStart[batch];
+    }
+
+    // NOTE: Slots are handed out in order first, so that the matrices can then be built for
+    //       every body independently (in parallel once there are enough bodies for it)
+    instances.resize(bodies.size());
+    instanceSlots.resize(bodies.size());
+    int batchFill[BODY_TEXTURE_COUNT];
+    for (int batch = 0; batch < batchCount; batch++)
+    {
+        batchFill[batch] = batchStart[batch];
+    }
+    for (size_t i = 0; i < bodies.size(); i++)
+    {
+        instanceSlots[i] = batchFill[batchOf[bodies[i].texture]]++;
+    }
+    perfcounters::Region matrixRegion("matrix building");
+    jobsystem::parallelFor(bodies.size(), BODIES_PER_JOB, [&](size_t first, size_t last)
+    {
+        for (size_t i = first; i < last; i++)
+        {
+            BodyInstance& instance = instances[instanceSlots[i]];
+            instance.model = bodyModelMatrix(bodies[i]);
+            instance.textureLayer = (float)layerOf[bodies[i].texture];
+        }
+    });
+    matrixRegion.end(bodies.size());
+
+    // NOTE: Re-specifying the whole store each frame lets the driver orphan the old one instead of
+    //       waiting for the previous frame's draws to finish reading it
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+    if (instances.size() > instanceCapacity)
+    {
+        instanceCapacity = instances.capacity();
+    }
+    glBufferData(GL_ARRAY_BUFFER, sizeof(BodyInstance) * instanceCapacity, NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(BodyInstance) * instances.size(), instances.data());
+
+    for (int batch = 0; batch < batchCount; batch++)
+    {
+        int instanceCount = batchStart[batch + 1] - batchStart[batch];
+        if (instanceCount == 0)
+        {
+            continue;
+        }
+
+        // There is no base instance in GL 3.3, so point the per-instance attributes at this
+        // batch's slice of the instance buffer instead
+        size_t offset = sizeof(BodyInstance) * batchStart[batch];
+        for (int column = 0; column < 4; column++)
+        {
+            glVertexAttribPointer(3 + column, 4, GL_FLOAT, GL_FALSE, sizeof(BodyInstance),
+                                  (void*)(offset + column * sizeof(glm::vec4)));
+        }
+        glVertexAttribPointer(7, 1, GL_FLOAT, GL_FALSE, sizeof(BodyInstance),
+                              (void*)(offset + offsetof(BodyInstance, textureLayer)));
+
+        int batchScope = profiler.beginScope(BATCH_SCOPE_NAMES[batch]);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, batchTextures[batch]);
+        glDrawElementsInstanced(GL_TRIANGLES, indexCount, indexType, (void*)0, instanceCount);
+        profiler.endScope(batchScope);
+    }
+}
+
+void OpenGLWindow::render(float a, float b, float theta, float phi, float zoom)
+{
+    PROFILE_ZONE("render");
+    Uint64 renderStart = SDL_GetPerformanceCounter();
+    profiler.beginFrame();
+    hud.addFrame(cpuFrameTime, profiler.collectedFrameTime());
+
+    int uploadScope = profiler.beginScope("texture uploads");
+    textureStreamer.update();
+    profiler.endScope(uploadScope);
 
     // Calculate the view matrix for the camera
     glm::vec3 cameraPosition = glm::vec3(10.0f * cos(glm::radians(theta)) * sin(glm::radians(phi)), 10.0f * sin(glm::radians(theta))* sin(glm::radians(phi)), 10.0f * cos(glm::radians(phi)));  // Adjust the position based on your preference
     glm::vec3 cameraTarget = glm::vec3(0.0f, 0.0f, -1.0f);  // Target towards the center of the scene
     glm::vec3 cameraUp = glm::vec3(0.0f, 1.0f, 0.0f);       // Up direction for the camera
-    glm::mat4 viewMatrix = glm::lookAt(cameraPosition, cameraTarget, cameraUp);
-    GLint viewLoc = glGetUniformLocation(shader, "view");
-    glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(viewMatrix));
+    frameUniforms.view = glm::lookAt(cameraPosition, cameraTarget, cameraUp);
+    frameUniforms.viewPos = glm::vec4(cameraPosition, 1.0f);
 
     // Calculate the projection matrix (perspective projection)
     float fov = glm::radians(zoom);
-    float aspectRatio = 4.0f/3.0f; 
+    float aspectRatio = (float)settings.width / settings.height;
     float nearPlane = 0.1f;
     float farPlane = 100.0f;
-    glm::mat4 projectionMatrix = glm::perspective(fov, aspectRatio, nearPlane, farPlane);
-    GLint projectionLoc = glGetUniformLocation(shader, "projection");
-    glUniformMatrix4fv(projectionLoc, 1, GL_FALSE, glm::value_ptr(projectionMatrix));
-
-    // Lighting and material properties
-    glm::vec3 lightPos = glm::vec3(1.2f * cos(glm::radians(theta)), 1.0f, 2.0f * sin(glm::radians(theta))); // Moving light
-    glm::vec3 lightAmbient(0.2f, 0.2f, 0.2f);
-    glm::vec3 lightDiffuse(0.5f, 0.5f, 0.5f);
-    glm::vec3 lightSpecular(1.0f, 1.0f, 1.0f);
-    
-    glm::vec3 materialAmbient(1.0f, 0.5f, 0.31f);
-    glm::vec3 materialDiffuse(1.0f, 0.5f, 0.31f);
-    glm::vec3 materialSpecular(0.5f, 0.5f, 0.5f);
-    float materialShininess = 32.0f;
-
-    glUniform3fv(glGetUniformLocation(shader, "light.position"), 1, glm::value_ptr(lightPos));
-    glUniform3fv(glGetUniformLocation(shader, "light.ambient"), 1, glm::value_ptr(lightAmbient));
-    glUniform3fv(glGetUniformLocation(shader, "light.diffuse"), 1, glm::value_ptr(lightDiffuse));
-    glUniform3fv(glGetUniformLocation(shader, "light.specular"), 1, glm::value_ptr(lightSpecular));
-
-    // Pass material information to shaders
-    glUniform3fv(glGetUniformLocation(shader, "material.ambient"), 1, glm::value_ptr(materialAmbient));
-    glUniform3fv(glGetUniformLocation(shader, "material.diffuse"), 1, glm::value_ptr(materialDiffuse));
-    glUniform3fv(glGetUniformLocation(shader, "material.specular"), 1, glm::value_ptr(materialSpecular));
-    glUniform1f(glGetUniformLocation(shader, "material.shininess"), materialShininess);
-
-    // Pass view position to shaders
-    glUniform3fv(glGetUniformLocation(shader, "viewPos"), 1, glm::value_ptr(cameraPosition));
-    
-    vertexCount = geometry.vertexCount();
+    frameUniforms.projection = glm::perspective(fov, aspectRatio, nearPlane, farPlane);
 
-    glGenBuffers(1, &vertexBuffer);
-    glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);    
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    // Lighting properties (the light moves with the camera angle)
+    frameUniforms.lightPosition = glm::vec4(1.2f * cos(glm::radians(theta)), 1.0f, 2.0f * sin(glm::radians(theta)), 1.0f);
+    frameUniforms.lightAmbient = glm::vec4(0.2f, 0.2f, 0.2f, 0.0f);
+    frameUniforms.lightDiffuse = glm::vec4(0.5f, 0.5f, 0.5f, 0.0f);
+    frameUniforms.lightSpecular = glm::vec4(1.0f, 1.0f, 1.0f, 0.0f);
 
-    string images[3] = {"sun_texture.png", "earth_diffuse.png", "moon_diffuse.png"};
-    std::vector<GLuint> textures(3);
-    glGenTextures(3, textures.data()); 
-    for (int i = 0; i < 3; i++){
-               
-        glBindTexture(GL_TEXTURE_2D, textures[i]);  
-
-        int widthImg, heightImg, numColCh;
-        stbi_set_flip_vertically_on_load(true);
-        unsigned char* bytes = stbi_load(images[i].c_str(), &widthImg, &heightImg, &numColCh, 4);        
-        if (bytes)
-        {
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, widthImg, heightImg, 0, GL_RGBA, GL_UNSIGNED_BYTE, bytes);
-            glGenerateMipmap(GL_TEXTURE_2D);
-        }
-        else
-        {
-            std::cout << "Failed to load texture" << std::endl;
-        }
-        stbi_image_free(bytes);
+    // NOTE: All of the per-frame shader state goes up in this one call. Re-specifying the whole
+    //       store lets the driver hand us a fresh buffer rather than sync with the previous frame.
+    glBindBuffer(GL_UNIFORM_BUFFER, frameUniformBuffer);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameUniforms), &frameUniforms, GL_STREAM_DRAW);
 
-        // Set the texture parameters
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    int clearScope = profiler.beginScope("clear");
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    profiler.endScope(clearScope);
 
-        
+    perfcounters::Region orbitRegion("orbit propagation");
+    computeBodyStates(a, b, bodies);
+    orbitRegion.end(bodies.size());
+    frameTriangles = (size_t)indexCount / 3 * bodies.size();
+    currentZoom = zoom;
+    {
+        PROFILE_ZONE("draw bodies");
+        drawBodies();
     }
 
-    auto vertices = static_cast<float*>(geometry.vertexData());  
-    auto texCoords = static_cast<float*>(geometry.textureCoordData());
-    auto normals = static_cast<float*>(geometry.normalData());
+    // glPrintError("Setup complete", true);
 
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    if (!settings.captureDirectory.empty())
+    {
+        int captureScope = profiler.beginScope("capture");
+        captureFrame();
+        profiler.endScope(captureScope);
+    }
 
-    int widthImg, heightImg, numColCh;       
-    
-    for (int i = 0; i < 3; ++i) {
-        glm::vec3 position, scale;
-        if (i == 0) {
-            position = glm::vec3(0.0f, 0.0f, -3.0f);
-            scale = glm::vec3(1.0f);
-        } else if (i == 1) {
-            position = glm::vec3(4.0f * cos(glm::radians(a)), 4.0f * sin(glm::radians(a)), -3.0f);
-            scale = glm::vec3(0.3f);
-        } else if (i == 2) {
-            position = glm::vec3(4.0f * cos(glm::radians(a)) + 1.5f * cos(glm::radians(b)), 4.0f * sin(glm::radians(a)) + 1.5f * sin(glm::radians(b)), -3.0f);
-            scale = glm::vec3(0.1f);
-        }        
-
-        std::vector<float> combinedData;
-
-        for (int j = 0; j < vertexCount; ++j) {
-            combinedData.push_back(vertices[j * 3]);
-            combinedData.push_back(vertices[j * 3 + 1]);
-            combinedData.push_back(vertices[j * 3 + 2]);
-            combinedData.push_back(texCoords[j * 2]);
-            combinedData.push_back(texCoords[j * 2 + 1]);
-            combinedData.push_back(normals[j * 3]);
-            combinedData.push_back(normals[j * 3 + 1]);
-            combinedData.push_back(normals[j * 3 + 2]);
-        }
-        
-        // Calculate the view model matrix for each instance
-        glm::mat4 modelMatrix = glm::translate(glm::mat4(1.0f), position);
-        modelMatrix = glm::scale(modelMatrix, scale);
-        GLint modelLoc = glGetUniformLocation(shader, "model");
-        glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(modelMatrix));      
-        
-        glBufferData(GL_ARRAY_BUFFER, sizeof(float) * combinedData.size(), combinedData.data(), GL_STATIC_DRAW);
-
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-        glEnableVertexAttribArray(0);    
-        
-        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3* sizeof(float)));
-        glEnableVertexAttribArray(1);
-
-        glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(5 * sizeof(float)));
-        glEnableVertexAttribArray(2);
-
-        glBindTexture(GL_TEXTURE_2D, textures[i]);
-        glDrawArrays(GL_TRIANGLES, 0, vertexCount);
-        
-    }   
-    // glPrintError("Setup complete", true);
+    // NOTE: Drawn after the capture so that captured frames stay reproducible
+    if (hud.visible())
+    {
+        drawHud();
+    }
+    frameIndex++;
+    profiler.endFrame();
+
+    // NOTE: Closed before the swap (which makes no GL calls of ours) so that the title bar and
+    //       whoever called render() see this frame's counts
+    glhooks::endFrame();
+
+    updateWindowTitle();
+    cpuFrameTime = 1000.0 * (SDL_GetPerformanceCounter() - renderStart) / SDL_GetPerformanceFrequency();
 
     // Swap the front and back buffers on the window, effectively putting what we just "drew"
     // onto the screen (whereas previously it only existed in memory)
+    PROFILE_ZONE("swap");
     SDL_GL_SwapWindow(sdlWin);
 }
 
+// The HUD shows the previous frame's counts, since this frame's are still being gathered
+void OpenGLWindow::drawHud()
+{
+    HudStats stats;
+    stats.drawCalls = glhooks::lastFrameCalls(glhooks::DrawElementsInstanced) +
+                      glhooks::lastFrameCalls(glhooks::DrawArrays);
+    stats.glCalls = glhooks::lastFrameCallCount();
+    stats.redundantGlCalls = glhooks::lastFrameRedundantCount();
+    stats.triangles = frameTriangles;
+    stats.textureBytes = glhooks::liveBytes(glhooks::TEXTURE_OBJECT);
+    stats.alphaIncrement = alphaIncrement;
+    stats.betaIncrement = betaIncrement;
+    stats.zoom = currentZoom;
+
+    int hudScope = profiler.beginScope("hud");
+    hud.draw(stats, settings.width, settings.height);
+    profiler.endScope(hudScope);
+
+    glDisable(GL_BLEND);
+    glEnable(GL_DEPTH_TEST);
+    glEnable(GL_CULL_FACE);
+    glUseProgram(shader);
+    glBindVertexArray(vao);
+}
+
+double OpenGLWindow::gpuFrameTime()
+{
+    return profiler.collectedFrameTime();
+}
+
+bool OpenGLWindow::texturesLoading()
+{
+    return textureStreamer.busy();
+}
+
+bool OpenGLWindow::vsyncActive()
+{
+    return settings.vsync && !settings.headless && SDL_GL_GetSwapInterval() != 0;
+}
+
+int OpenGLWindow::refreshRate()
+{
+    SDL_DisplayMode mode;
+    if(SDL_GetWindowDisplayMode(sdlWin, &mode) != 0 || mode.refresh_rate <= 0)
+    {
+        return 60;
+    }
+    return mode.refresh_rate;
+}
+
+const GpuProfiler& OpenGLWindow::gpuProfiler()
+{
+    return profiler;
+}
+
+void OpenGLWindow::toggleHud()
+{
+    hud.toggle();
+}
+
+bool OpenGLWindow::hudVisible()
+{
+    return hud.visible();
+}
+
+void OpenGLWindow::setSimulationSpeed(float alphaIncrement, float betaIncrement)
+{
+    this->alphaIncrement = alphaIncrement;
+    this->betaIncrement = betaIncrement;
+}
+
+// Shows the GL call count of the previous frame and the recent GPU frame times in the title bar,
+// refreshed about once a second
+void OpenGLWindow::updateWindowTitle()
+{
+    Uint32 now = SDL_GetTicks();
+    if (now - lastTitleUpdate < 1000)
+    {
+        return;
+    }
+    lastTitleUpdate = now;
+
+    char title[160];
+    snprintf(title, sizeof(title), "OpenGL Prac 1 | %u GL calls/frame | GPU %.2f ms avg, %.2f ms max",
+             glhooks::lastFrameCallCount(), profiler.averageTime(GpuProfiler::FRAME_SCOPE),
+             profiler.maxTime(GpuProfiler::FRAME_SCOPE));
+    SDL_SetWindowTitle(sdlWin, title);
+}
+
 // The program will exit if this function returns false
 bool OpenGLWindow::handleEvent(SDL_Event e)
 {
@@ -318,7 +626,24 @@ bool OpenGLWindow::handleEvent(SDL_Event e)
 
 void OpenGLWindow::cleanup()
 {
+    textureStreamer.shutdown();
+    profiler.shutdown();
+    hud.shutdown();
+    glDeleteFramebuffers(1, &framebuffer);
+    glDeleteRenderbuffers(1, &colorRenderbuffer);
+    glDeleteRenderbuffers(1, &depthRenderbuffer);
+    glDeleteBuffers(1, &frameUniformBuffer);
+    glDeleteBuffers(1, &materialUniformBuffer);
+    glDeleteBuffers(1, &instanceBuffer);
+    glDeleteBuffers(1, &elementBuffer);
     glDeleteBuffers(1, &vertexBuffer);
     glDeleteVertexArrays(1, &vao);
+    glDeleteProgram(shader);
+
+    // Everything should be gone by now; whatever is left over was leaked
+    glhooks::printObjectReport();
+    gldebug::printSummary();
+
+    SDL_GL_DeleteContext(glContext);
     SDL_DestroyWindow(sdlWin);
 }
@@ -3,25 +3,161 @@
 
 #include <GL/glew.h>
 
+#include <string>
+#include <vector>
+
 #include "geometry.h"
+#include "gpuprofiler.h"
+#include "hud.h"
+#include "scene.h"
+#include "shadercache.h"
+#include "texturestreamer.h"
+
+// How initGL() should set up the window and where render() draws to
+struct WindowSettings
+{
+    WindowSettings();
+
+    // Headless mode uses a hidden window (main() picks SDL's offscreen EGL driver when there is no
+    // display at all) and renders into an offscreen framebuffer of width x height
+    bool headless;
+    int width;
+    int height;
+    bool vsync;
+
+    // When set, every rendered frame is written here as frame_NNNNN.ppm
+    std::string captureDirectory;
+
+    // Finish streaming in every texture before initGL() returns, so that no frame shows the
+    // placeholders (implied by captureDirectory)
+    bool waitForTextures;
+
+    // Start with the performance HUD shown (it can always be toggled with F1)
+    bool showHud;
+};
 
 class OpenGLWindow
 {
 public:
     OpenGLWindow();
-    void initGL();
+    void initGL(const WindowSettings& settings);
     void render(float a, float b, float theta, float phi, float zoom);
     bool handleEvent(SDL_Event e);
     void cleanup();
 
+    // GPU time in milliseconds of a recently rendered frame, or -1 if none became available this
+    // frame. The result lags a few frames behind so that reading it never stalls the pipeline.
+    double gpuFrameTime();
+
+    // True while textures are still streaming in (and frames show placeholders)
+    bool texturesLoading();
+
+    // Whether presenting a frame actually waits for vertical sync (it never does when headless,
+    // and drivers may refuse it), and the refresh rate of the window's display (60 if unknown)
+    bool vsyncActive();
+    int refreshRate();
+
+    // Per-pass GPU times (clear, texture uploads, each body batch, ...)
+    const GpuProfiler& gpuProfiler();
+
+    void toggleHud();
+    bool hudVisible();
+
+    // Simulation speeds to show on the HUD
+    void setSimulationSpeed(float alphaIncrement, float betaIncrement);
+
 private:
+    // Per-instance vertex data for a body, matching the attributes in simple.vert
+    struct BodyInstance
+    {
+        glm::mat4 model;
+        float textureLayer;
+        float padding[3];
+    };
+
+    // std140 layouts of the FrameData and MaterialData uniform blocks in the shaders
+    struct FrameUniforms
+    {
+        glm::mat4 view;
+        glm::mat4 projection;
+        glm::vec4 viewPos;
+        glm::vec4 lightPosition;
+        glm::vec4 lightAmbient;
+        glm::vec4 lightDiffuse;
+        glm::vec4 lightSpecular;
+    };
+
+    struct MaterialUniforms
+    {
+        glm::vec4 ambient;
+        glm::vec4 diffuse;
+        glm::vec4 specular;
+        float shininess;
+        float padding[3];
+    };
+
+    static const GLuint FRAME_UNIFORM_BINDING = 0;
+    static const GLuint MATERIAL_UNIFORM_BINDING = 1;
+
+    // A body's matrix takes well under a microsecond, so only thousands of them are worth
+    // spreading over the job system
+    static const size_t BODIES_PER_JOB = 1024;
+
+    void initFramebuffer();
+    void captureFrame();
+    void initUniforms();
+    void loadTextures();
+    void drawBodies();
+    void drawHud();
+    void updateWindowTitle();
+
     SDL_Window* sdlWin;
+    SDL_GLContext glContext;
+    WindowSettings settings;
+
+    // Offscreen render target, only used in headless mode
+    GLuint framebuffer;
+    GLuint colorRenderbuffer;
+    GLuint depthRenderbuffer;
+    std::vector<unsigned char> capturePixels;
+    int frameIndex;
+
+    ShaderCache shaderCache;
 
     GLuint vao;
     GLuint shader;
     GLuint vertexBuffer;
     GLuint elementBuffer;
     GLuint vertexCount;
+    GLsizei indexCount;
+    GLenum indexType;
+
+    // One streamed texture handle per BodyTexture, requested once in initGL()
+    TextureStreamer textureStreamer;
+    int textureHandles[BODY_TEXTURE_COUNT];
+
+    // Kept between frames so that steady-state frames don't allocate
+    std::vector<BodyState> bodies;
+    std::vector<BodyInstance> instances;
+    std::vector<int> instanceSlots;
+    GLuint instanceBuffer;
+    size_t instanceCapacity;
+
+    FrameUniforms frameUniforms;
+    GLuint frameUniformBuffer;
+    GLuint materialUniformBuffer;
+    GLint textureLocation;
+
+    GpuProfiler profiler;
+
+    Hud hud;
+    float alphaIncrement;
+    float betaIncrement;
+    float currentZoom;
+    size_t frameTriangles;
+    double cpuFrameTime;
+
+    Uint32 lastTitleUpdate;
 };
 
 #endif
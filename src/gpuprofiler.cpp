@@ -0,0 +1,199 @@
+#include <string.h>
+
+#include "gpuprofiler.h"
+#include "glhooks.h"
+
+GpuProfiler::GpuProfiler()
+    : initialized(false), currentFrame(0), frameInstance(-1), statsCount(0), collectedThisFrame(false), dropped(0)
+{
+    memset(frames, 0, sizeof(frames));
+    memset(stats, 0, sizeof(stats));
+}
+
+void GpuProfiler::init()
+{
+    for(int i=0; i<FRAME_LATENCY; i++)
+    {
+        glGenQueries(MAX_SCOPES * 2, frames[i].queries);
+        frames[i].scopeCount = 0;
+        frames[i].pending = false;
+    }
+    findScope("frame");
+    initialized = true;
+}
+
+void GpuProfiler::shutdown()
+{
+    if(!initialized)
+    {
+        return;
+    }
+    for(int i=0; i<FRAME_LATENCY; i++)
+    {
+        glDeleteQueries(MAX_SCOPES * 2, frames[i].queries);
+    }
+    initialized = false;
+}
+
+int GpuProfiler::findScope(const char* name)
+{
+    for(int i=0; i<statsCount; i++)
+    {
+        if(stats[i].name == name || strcmp(stats[i].name, name) == 0)
+        {
+            return i;
+        }
+    }
+    if(statsCount == MAX_SCOPES)
+    {
+        return -1;
+    }
+    stats[statsCount].name = name;
+    return statsCount++;
+}
+
+void GpuProfiler::collect(FrameQueries& frame)
+{
+    // NOTE: Timestamps complete in submission order, so once the frame's closing timestamp is
+    //       available so are all the others
+    GLint available = 0;
+    glGetQueryObjectiv(frame.queries[1], GL_QUERY_RESULT_AVAILABLE, &available);
+    if(!available)
+    {
+        dropped++;
+        return;
+    }
+
+    for(int i=0; i<frame.scopeCount; i++)
+    {
+        if(!frame.scopes[i].ended)
+        {
+            continue;
+        }
+        GLuint64 start = 0;
+        GLuint64 end = 0;
+        glGetQueryObjectui64v(frame.queries[i*2], GL_QUERY_RESULT, &start);
+        glGetQueryObjectui64v(frame.queries[i*2 + 1], GL_QUERY_RESULT, &end);
+
+        ScopeStats& scope = stats[frame.scopes[i].scope];
+        scope.last = (end > start) ? (end - start) / 1.0e6 : 0.0;
+        scope.history[scope.historyNext] = scope.last;
+        scope.historyNext = (scope.historyNext + 1) % HISTORY_LENGTH;
+        if(scope.historyCount < HISTORY_LENGTH)
+        {
+            scope.historyCount++;
+        }
+    }
+    collectedThisFrame = true;
+}
+
+void GpuProfiler::beginFrame()
+{
+    collectedThisFrame = false;
+    if(!initialized)
+    {
+        return;
+    }
+
+    currentFrame = (currentFrame + 1) % FRAME_LATENCY;
+    FrameQueries& frame = frames[currentFrame];
+    if(frame.pending)
+    {
+        collect(frame);
+    }
+    frame.scopeCount = 0;
+    frame.pending = false;
+    frameInstance = beginScope(stats[FRAME_SCOPE].name);
+}
+
+void GpuProfiler::endFrame()
+{
+    if(!initialized)
+    {
+        return;
+    }
+    endScope(frameInstance);
+    frames[currentFrame].pending = true;
+}
+
+int GpuProfiler::beginScope(const char* name)
+{
+    FrameQueries& frame = frames[currentFrame];
+    if(!initialized || frame.scopeCount == MAX_SCOPES)
+    {
+        return -1;
+    }
+    int scope = findScope(name);
+    if(scope < 0)
+    {
+        return -1;
+    }
+
+    int index = frame.scopeCount++;
+    frame.scopes[index].scope = scope;
+    frame.scopes[index].ended = false;
+    glQueryCounter(frame.queries[index*2], GL_TIMESTAMP);
+    return index;
+}
+
+void GpuProfiler::endScope(int scope)
+{
+    FrameQueries& frame = frames[currentFrame];
+    if(!initialized || scope < 0 || scope >= frame.scopeCount || frame.scopes[scope].ended)
+    {
+        return;
+    }
+    glQueryCounter(frame.queries[scope*2 + 1], GL_TIMESTAMP);
+    frame.scopes[scope].ended = true;
+}
+
+int GpuProfiler::scopeCount() const
+{
+    return statsCount;
+}
+
+const char* GpuProfiler::scopeName(int scope) const
+{
+    return stats[scope].name;
+}
+
+double GpuProfiler::lastTime(int scope) const
+{
+    return stats[scope].last;
+}
+
+double GpuProfiler::averageTime(int scope) const
+{
+    const ScopeStats& stat = stats[scope];
+    if(stat.historyCount == 0)
+    {
+        return 0.0;
+    }
+    double sum = 0.0;
+    for(int i=0; i<stat.historyCount; i++)
+    {
+        sum += stat.history[i];
+    }
+    return sum / stat.historyCount;
+}
+
+double GpuProfiler::maxTime(int scope) const
+{
+    const ScopeStats& stat = stats[scope];
+    double result = 0.0;
+    for(int i=0; i<stat.historyCount; i++)
+    {
+        result = (stat.history[i] > result) ? stat.history[i] : result;
+    }
+    return result;
+}
+
+double GpuProfiler::collectedFrameTime() const
+{
+    return collectedThisFrame ? stats[FRAME_SCOPE].last : -1.0;
+}
+
+int GpuProfiler::droppedFrames() const
+{
+    return dropped;
+}
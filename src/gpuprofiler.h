@@ -0,0 +1,91 @@
+#ifndef GPU_PROFILER_H
+#define GPU_PROFILER_H
+
+#include <GL/glew.h>
+
+// Measures how long the GPU spends on each part of a frame. Every scope is bracketed by a pair of
+// GL_TIMESTAMP queries (glQueryCounter), so scopes can nest and the whole frame comes for free as
+// the outermost one. The queries live in a ring of FRAME_LATENCY frames and a frame's results are
+// only read back when its slot comes around again; by then the GPU has long finished them, so the
+// profiler never stalls the pipeline. If a frame's results still aren't ready at that point they
+// are dropped rather than waited for.
+//
+// Scopes are identified by name, which must be a string literal (or otherwise outlive the
+// profiler). For each scope the profiler keeps the latest time and the average and maximum over
+// the last HISTORY_LENGTH collected frames.
+class GpuProfiler
+{
+public:
+    static const int FRAME_LATENCY = 4;
+    static const int MAX_SCOPES = 16;
+    static const int HISTORY_LENGTH = 120;
+
+    // Scope 0 always covers the whole frame, from beginFrame() to endFrame()
+    static const int FRAME_SCOPE = 0;
+
+    GpuProfiler();
+
+    // Must be called with a current GL context
+    void init();
+    void shutdown();
+
+    // Collects the results of the oldest frame in the ring and starts timing a new one
+    void beginFrame();
+    void endFrame();
+
+    // Returns the id to pass to endScope(), or -1 if this frame is out of scopes
+    int beginScope(const char* name);
+    void endScope(int scope);
+
+    // Results, in milliseconds. Scope ids are stable for the lifetime of the profiler.
+    int scopeCount() const;
+    const char* scopeName(int scope) const;
+    double lastTime(int scope) const;
+    double averageTime(int scope) const;
+    double maxTime(int scope) const;
+
+    // GPU time of the frame collected by the last beginFrame(), or -1 if none was
+    double collectedFrameTime() const;
+
+    // Frames whose results weren't ready in time and were dropped
+    int droppedFrames() const;
+
+private:
+    struct ScopeStats
+    {
+        const char* name;
+        double history[HISTORY_LENGTH];
+        int historyCount;
+        int historyNext;
+        double last;
+    };
+
+    // The timestamp pair of one scope instance within a frame
+    struct ScopeQueries
+    {
+        int scope;
+        bool ended;
+    };
+
+    struct FrameQueries
+    {
+        GLuint queries[MAX_SCOPES * 2];
+        ScopeQueries scopes[MAX_SCOPES];
+        int scopeCount;
+        bool pending;
+    };
+
+    int findScope(const char* name);
+    void collect(FrameQueries& frame);
+
+    bool initialized;
+    FrameQueries frames[FRAME_LATENCY];
+    int currentFrame;
+    int frameInstance;
+    ScopeStats stats[MAX_SCOPES];
+    int statsCount;
+    bool collectedThisFrame;
+    int dropped;
+};
+
+#endif
@@ -0,0 +1,412 @@
+#include <iostream>
+#include <stdio.h>
+#include "SDL.h"
+#include "hud.h"
+#include "gldebug.h"
+#include "glhooks.h"
+#include "profiler.h"
+
+using namespace std;
+
+// 8x8 glyphs for printable ASCII (32-126), one byte per row from the top with the least
+// significant bit as the leftmost pixel. These are the public domain font8x8_basic glyphs, which
+// come from the IBM PC BIOS font.
+static const int FIRST_GLYPH = 32;
+static const int GLYPH_COUNT = 95;
+static const int GLYPH_SIZE = 8;
+static const unsigned char FONT_GLYPHS[GLYPH_COUNT][GLYPH_SIZE] =
+{
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // space
+    {0x18, 0x3C, 0x3C, 0x18, 0x18, 0x00, 0x18, 0x00}, // !
+    {0x36, 0x36, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // "
+    {0x36, 0x36, 0x7F, 0x36, 0x7F, 0x36, 0x36, 0x00}, // #
+    {0x0C, 0x3E, 0x03, 0x1E, 0x30, 0x1F, 0x0C, 0x00}, // $
+    {0x00, 0x63, 0x33, 0x18, 0x0C, 0x66, 0x63, 0x00}, // %
+    {0x1C, 0x36, 0x1C, 0x6E, 0x3B, 0x33, 0x6E, 0x00}, // &
+    {0x06, 0x06, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00}, // '
+    {0x18, 0x0C, 0x06, 0x06, 0x06, 0x0C, 0x18, 0x00}, // (
+    {0x06, 0x0C, 0x18, 0x18, 0x18, 0x0C, 0x06, 0x00}, // )
+    {0x00, 0x66, 0x3C, 0xFF, 0x3C, 0x66, 0x00, 0x00}, // *
+    {0x00, 0x0C, 0x0C, 0x3F, 0x0C, 0x0C, 0x00, 0x00}, // +
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C, 0x06}, // ,
+    {0x00, 0x00, 0x00, 0x3F, 0x00, 0x00, 0x00, 0x00}, // -
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C, 0x00}, // .
+    {0x60, 0x30, 0x18, 0x0C, 0x06, 0x03, 0x01, 0x00}, // /
+    {0x3E, 0x63, 0x73, 0x7B, 0x6F, 0x67, 0x3E, 0x00}, // 0
+    {0x0C, 0x0E, 0x0C, 0x0C, 0x0C, 0x0C, 0x3F, 0x00}, // 1
+    {0x1E, 0x33, 0x30, 0x1C, 0x06, 0x33, 0x3F, 0x00}, // 2
+    {0x1E, 0x33, 0x30, 0x1C, 0x30, 0x33, 0x1E, 0x00}, // 3
+    {0x38, 0x3C, 0x36, 0x33, 0x7F, 0x30, 0x78, 0x00}, // 4
+    {0x3F, 0x03, 0x1F, 0x30, 0x30, 0x33, 0x1E, 0x00}, // 5
+    {0x1C, 0x06, 0x03, 0x1F, 0x33, 0x33, 0x1E, 0x00}, // 6
+    {0x3F, 0x33, 0x30, 0x18, 0x0C, 0x0C, 0x0C, 0x00}, // 7
+    {0x1E, 0x33, 0x33, 0x1E, 0x33, 0x33, 0x1E, 0x00}, // 8
+    {0x1E, 0x33, 0x33, 0x3E, 0x30, 0x18, 0x0E, 0x00}, // 9
+    {0x00, 0x0C, 0x0C, 0x00, 0x00, 0x0C, 0x0C, 0x00}, // :
+    {0x00, 0x0C, 0x0C, 0x00, 0x00, 0x0C, 0x0C, 0x06}, // ;
+    {0x18, 0x0C, 0x06, 0x03, 0x06, 0x0C, 0x18, 0x00}, // <
+    {0x00, 0x00, 0x3F, 0x00, 0x00, 0x3F, 0x00, 0x00}, // =
+    {0x06, 0x0C, 0x18, 0x30, 0x18, 0x0C, 0x06, 0x00}, // >
+    {0x1E, 0x33, 0x30, 0x18, 0x0C, 0x00, 0x0C, 0x00}, // ?
+    {0x3E, 0x63, 0x7B, 0x7B, 0x7B, 0x03, 0x1E, 0x00}, // @
+    {0x0C, 0x1E, 0x33, 0x33, 0x3F, 0x33, 0x33, 0x00}, // A
+    {0x3F, 0x66, 0x66, 0x3E, 0x66, 0x66, 0x3F, 0x00}, // B
+    {0x3C, 0x66, 0x03, 0x03, 0x03, 0x66, 0x3C, 0x00}, // C
+    {0x1F, 0x36, 0x66, 0x66, 0x66, 0x36, 0x1F, 0x00}, // D
+    {0x7F, 0x46, 0x16, 0x1E, 0x16, 0x46, 0x7F, 0x00}, // E
+    {0x7F, 0x46, 0x16, 0x1E, 0x16, 0x06, 0x0F, 0x00}, // F
+    {0x3C, 0x66, 0x03, 0x03, 0x73, 0x66, 0x7C, 0x00}, // G
+    {0x33, 0x33, 0x33, 0x3F, 0x33, 0x33, 0x33, 0x00}, // H
+    {0x1E, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x1E, 0x00}, // I
+    {0x78, 0x30, 0x30, 0x30, 0x33, 0x33, 0x1E, 0x00}, // J
+    {0x67, 0x66, 0x36, 0x1E, 0x36, 0x66, 0x67, 0x00}, // K
+    {0x0F, 0x06, 0x06, 0x06, 0x46, 0x66, 0x7F, 0x00}, // L
+    {0x63, 0x77, 0x7F, 0x7F, 0x6B, 0x63, 0x63, 0x00}, // M
+    {0x63, 0x67, 0x6F, 0x7B, 0x73, 0x63, 0x63, 0x00}, // N
+    {0x1C, 0x36, 0x63, 0x63, 0x63, 0x36, 0x1C, 0x00}, // O
+    {0x3F, 0x66, 0x66, 0x3E, 0x06, 0x06, 0x0F, 0x00}, // P
+    {0x1E, 0x33, 0x33, 0x33, 0x3B, 0x1E, 0x38, 0x00}, // Q
+    {0x3F, 0x66, 0x66, 0x3E, 0x36, 0x66, 0x67, 0x00}, // R
+    {0x1E, 0x33, 0x07, 0x0E, 0x38, 0x33, 0x1E, 0x00}, // S
+    {0x3F, 0x2D, 0x0C, 0x0C, 0x0C, 0x0C, 0x1E, 0x00}, // T
+    {0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x3F, 0x00}, // U
+    {0x33, 0x33, 0x33, 0x33, 0x33, 0x1E, 0x0C, 0x00}, // V
+    {0x63, 0x63, 0x63, 0x6B, 0x7F, 0x77, 0x63, 0x00}, // W
+    {0x63, 0x63, 0x36, 0x1C, 0x1C, 0x36, 0x63, 0x00}, // X
+    {0x33, 0x33, 0x33, 0x1E, 0x0C, 0x0C, 0x1E, 0x00}, // Y
+    {0x7F, 0x63, 0x31, 0x18, 0x4C, 0x66, 0x7F, 0x00}, // Z
+    {0x1E, 0x06, 0x06, 0x06, 0x06, 0x06, 0x1E, 0x00}, // [
+    {0x03, 0x06, 0x0C, 0x18, 0x30, 0x60, 0x40, 0x00}, // backslash
+    {0x1E, 0x18, 0x18, 0x18, 0x18, 0x18, 0x1E, 0x00}, // ]
+    {0x08, 0x1C, 0x36, 0x63, 0x00, 0x00, 0x00, 0x00}, // ^
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF}, // _
+    {0x0C, 0x0C, 0x18, 0x00, 0x00, 0x00, 0x00, 0x00}, // `
+    {0x00, 0x00, 0x1E, 0x30, 0x3E, 0x33, 0x6E, 0x00}, // a
+    {0x07, 0x06, 0x06, 0x3E, 0x66, 0x66, 0x3B, 0x00}, // b
+    {0x00, 0x00, 0x1E, 0x33, 0x03, 0x33, 0x1E, 0x00}, // c
+    {0x38, 0x30, 0x30, 0x3E, 0x33, 0x33, 0x6E, 0x00}, // d
+    {0x00, 0x00, 0x1E, 0x33, 0x3F, 0x03, 0x1E, 0x00}, // e
+    {0x1C, 0x36, 0x06, 0x0F, 0x06, 0x06, 0x0F, 0x00}, // f
+    {0x00, 0x00, 0x6E, 0x33, 0x33, 0x3E, 0x30, 0x1F}, // g
+    {0x07, 0x06, 0x36, 0x6E, 0x66, 0x66, 0x67, 0x00}, // h
+    {0x0C, 0x00, 0x0E, 0x0C, 0x0C, 0x0C, 0x1E, 0x00}, // i
+    {0x30, 0x00, 0x30, 0x30, 0x30, 0x33, 0x33, 0x1E}, // j
+    {0x07, 0x06, 0x66, 0x36, 0x1E, 0x36, 0x67, 0x00}, // k
+    {0x0E, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x1E, 0x00}, // l
+    {0x00, 0x00, 0x33, 0x7F, 0x7F, 0x6B, 0x63, 0x00}, // m
+    {0x00, 0x00, 0x1F, 0x33, 0x33, 0x33, 0x33, 0x00}, // n
+    {0x00, 0x00, 0x1E, 0x33, 0x33, 0x33, 0x1E, 0x00}, // o
+    {0x00, 0x00, 0x3B, 0x66, 0x66, 0x3E, 0x06, 0x0F}, // p
+    {0x00, 0x00, 0x6E, 0x33, 0x33, 0x3E, 0x30, 0x78}, // q
+    {0x00, 0x00, 0x3B, 0x6E, 0x66, 0x06, 0x0F, 0x00}, // r
+    {0x00, 0x00, 0x3E, 0x03, 0x1E, 0x30, 0x1F, 0x00}, // s
+    {0x08, 0x0C, 0x3E, 0x0C, 0x0C, 0x2C, 0x18, 0x00}, // t
+    {0x00, 0x00, 0x33, 0x33, 0x33, 0x33, 0x6E, 0x00}, // u
+    {0x00, 0x00, 0x33, 0x33, 0x33, 0x1E, 0x0C, 0x00}, // v
+    {0x00, 0x00, 0x63, 0x6B, 0x7F, 0x7F, 0x36, 0x00}, // w
+    {0x00, 0x00, 0x63, 0x36, 0x1C, 0x36, 0x63, 0x00}, // x
+    {0x00, 0x00, 0x33, 0x33, 0x33, 0x3E, 0x30, 0x1F}, // y
+    {0x00, 0x00, 0x3F, 0x19, 0x0C, 0x26, 0x3F, 0x00}, // z
+    {0x38, 0x0C, 0x0C, 0x07, 0x0C, 0x0C, 0x38, 0x00}, // {
+    {0x18, 0x18, 0x18, 0x00, 0x18, 0x18, 0x18, 0x00}, // |
+    {0x07, 0x0C, 0x0C, 0x38, 0x0C, 0x0C, 0x07, 0x00}, // }
+    {0x6E, 0x3B, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // ~
+};
+
+// The atlas is a 16x6 grid of glyph cells. The one cell left over after the glyphs is filled in
+// completely and used for solid quads.
+static const int ATLAS_COLUMNS = 16;
+static const int ATLAS_ROWS = 6;
+static const int ATLAS_WIDTH = ATLAS_COLUMNS * GLYPH_SIZE;
+static const int ATLAS_HEIGHT = ATLAS_ROWS * GLYPH_SIZE;
+static const int SOLID_CELL = GLYPH_COUNT;
+
+// Layout, in pixels
+static const float PANEL_MARGIN = 8.0f;
+static const float PANEL_PADDING = 6.0f;
+static const float LINE_HEIGHT = 11.0f;
+static const float BAR_WIDTH = 2.0f;
+static const float GRAPH_WIDTH = Hud::HISTORY_LENGTH * BAR_WIDTH;
+static const float GRAPH_HEIGHT = 36.0f;
+static const float PANEL_WIDTH = GRAPH_WIDTH + 2 * PANEL_PADDING;
+
+// Graphs span twice the 60Hz frame budget, with a line marking the budget itself
+static const float FRAME_BUDGET_MS = 1000.0f / 60.0f;
+
+Hud::Hud()
+    : shown(false), program(0), vao(0), vertexBuffer(0), fontTexture(0), screenSizeLocation(-1),
+      vertexCount(0), lastFrame(0)
+{
+    cpuTimes.count = cpuTimes.next = 0;
+    gpuTimes.count = gpuTimes.next = 0;
+    frameIntervals.count = frameIntervals.next = 0;
+}
+
+void Hud::init(ShaderCache& shaderCache)
+{
+    program = shaderCache.loadProgram("hud.vert", "hud.frag");
+    glUseProgram(program);
+    gldebug::label(GL_PROGRAM, program, "hud");
+    screenSizeLocation = glGetUniformLocation(program, "ScreenSize");
+    GLint fontLocation = glGetUniformLocation(program, "Font");
+    glUniform1i(fontLocation, 0);
+
+    // Expand the glyph bitmaps into the atlas
+    std::vector<unsigned char> pixels(ATLAS_WIDTH * ATLAS_HEIGHT, 0);
+    for(int cell=0; cell<=SOLID_CELL; cell++)
+    {
+        int cellX = (cell % ATLAS_COLUMNS) * GLYPH_SIZE;
+        int cellY = (cell / ATLAS_COLUMNS) * GLYPH_SIZE;
+        for(int y=0; y<GLYPH_SIZE; y++)
+        {
+            unsigned char row = (cell == SOLID_CELL) ? 0xFF : FONT_GLYPHS[cell][y];
+            for(int x=0; x<GLYPH_SIZE; x++)
+            {
+                pixels[(cellY + y) * ATLAS_WIDTH + cellX + x] = ((row >> x) & 1) ? 255 : 0;
+            }
+        }
+    }
+
+    glGenTextures(1, &fontTexture);
+    glBindTexture(GL_TEXTURE_2D, fontTexture);
+    gldebug::label(GL_TEXTURE, fontTexture, "hud font");
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, ATLAS_WIDTH, ATLAS_HEIGHT, 0, GL_RED, GL_UNSIGNED_BYTE, pixels.data());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    vertices.resize(MAX_QUADS * 6);
+
+    glGenVertexArrays(1, &vao);
+    glBindVertexArray(vao);
+    gldebug::label(GL_VERTEX_ARRAY, vao, "hud");
+
+    glGenBuffers(1, &vertexBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+    gldebug::label(GL_BUFFER, vertexBuffer, "hud vertices");
+    glBufferData(GL_ARRAY_BUFFER, sizeof(Vertex) * vertices.size(), NULL, GL_STREAM_DRAW);
+
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, x));
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, u));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), (void*)offsetof(Vertex, color));
+    glEnableVertexAttribArray(2);
+}
+
+void Hud::shutdown()
+{
+    glDeleteBuffers(1, &vertexBuffer);
+    glDeleteVertexArrays(1, &vao);
+    glDeleteTextures(1, &fontTexture);
+    glDeleteProgram(program);
+}
+
+void Hud::toggle()
+{
+    shown = !shown;
+}
+
+bool Hud::visible()
+{
+    return shown;
+}
+
+void Hud::push(History& history, float sample)
+{
+    history.samples[history.next] = sample;
+    history.next = (history.next + 1) % HISTORY_LENGTH;
+    if(history.count < HISTORY_LENGTH)
+    {
+        history.count++;
+    }
+}
+
+float Hud::average(const History& history)
+{
+    if(history.count == 0)
+    {
+        return 0.0f;
+    }
+    float sum = 0.0f;
+    for(int i=0; i<history.count; i++)
+    {
+        sum += history.samples[i];
+    }
+    return sum / history.count;
+}
+
+void Hud::addFrame(double cpuTime, double gpuTime)
+{
+    uint64_t now = SDL_GetPerformanceCounter();
+    if(lastFrame != 0)
+    {
+        push(frameIntervals, (float)(1000.0 * (now - lastFrame) / SDL_GetPerformanceFrequency()));
+    }
+    lastFrame = now;
+
+    push(cpuTimes, (float)cpuTime);
+    if(gpuTime >= 0.0)
+    {
+        push(gpuTimes, (float)gpuTime);
+    }
+}
+
+void Hud::addQuad(float x0, float y0, float x1, float y1, float u0, float v0, float u1, float v1, Color color)
+{
+    if(vertexCount + 6 > (int)vertices.size())
+    {
+        return;
+    }
+
+    Vertex* quad = &vertices[vertexCount];
+    Vertex topLeft = {x0, y0, u0, v0, color};
+    Vertex topRight = {x1, y0, u1, v0, color};
+    Vertex bottomLeft = {x0, y1, u0, v1, color};
+    Vertex bottomRight = {x1, y1, u1, v1, color};
+    quad[0] = topLeft;
+    quad[1] = bottomLeft;
+    quad[2] = bottomRight;
+    quad[3] = topLeft;
+    quad[4] = bottomRight;
+    quad[5] = topRight;
+    vertexCount += 6;
+}
+
+void Hud::addSolid(float x0, float y0, float x1, float y1, Color color)
+{
+    // Sample the middle of the solid cell so that every texel read is fully set
+    float u = ((SOLID_CELL % ATLAS_COLUMNS) + 0.5f) * GLYPH_SIZE / ATLAS_WIDTH;
+    float v = ((SOLID_CELL / ATLAS_COLUMNS) + 0.5f) * GLYPH_SIZE / ATLAS_HEIGHT;
+    addQuad(x0, y0, x1, y1, u, v, u, v, color);
+}
+
+void Hud::addText(float x, float y, const char* text, Color color)
+{
+    for(const char* c=text; *c; c++, x+=GLYPH_SIZE)
+    {
+        int glyph = (unsigned char)*c - FIRST_GLYPH;
+        if(glyph <= 0 || glyph >= GLYPH_COUNT)
+        {
+            continue; // Spaces (and anything unprintable) don't need a quad
+        }
+        float u0 = (float)((glyph % ATLAS_COLUMNS) * GLYPH_SIZE) / ATLAS_WIDTH;
+        float v0 = (float)((glyph / ATLAS_COLUMNS) * GLYPH_SIZE) / ATLAS_HEIGHT;
+        float u1 = u0 + (float)GLYPH_SIZE / ATLAS_WIDTH;
+        float v1 = v0 + (float)GLYPH_SIZE / ATLAS_HEIGHT;
+        addQuad(x, y, x + GLYPH_SIZE, y + GLYPH_SIZE, u0, v0, u1, v1, color);
+    }
+}
+
+// One bar per sample, oldest on the left. Bars are scaled so the graph spans twice the budget;
+// anything over that is clipped and drawn in red.
+void Hud::addGraph(float x, float y, float width, float height, const History& history, float budget, Color color)
+{
+    static const Color BACKGROUND = {255, 255, 255, 24};
+    static const Color BUDGET_LINE = {255, 255, 255, 96};
+    static const Color OVER_BUDGET = {240, 80, 60, 255};
+
+    addSolid(x, y, x + width, y + height, BACKGROUND);
+
+    float bottom = y + height;
+    float scale = height / (2.0f * budget);
+    float barX = x + width - history.count * BAR_WIDTH;
+    for(int i=0; i<history.count; i++, barX+=BAR_WIDTH)
+    {
+        float sample = history.samples[(history.next - history.count + i + HISTORY_LENGTH) % HISTORY_LENGTH];
+        float barHeight = sample * scale;
+        Color barColor = color;
+        if(barHeight > height)
+        {
+            barHeight = height;
+            barColor = OVER_BUDGET;
+        }
+        addSolid(barX, bottom - barHeight, barX + BAR_WIDTH - 0.5f, bottom, barColor);
+    }
+
+    float budgetY = bottom - budget * scale;
+    addSolid(x, budgetY, x + width, budgetY + 1.0f, BUDGET_LINE);
+}
+
+void Hud::draw(const HudStats& stats, int width, int height)
+{
+    PROFILE_ZONE("hud");
+    static const Color PANEL = {0, 0, 0, 160};
+    static const Color TEXT = {230, 230, 230, 255};
+    static const Color CPU_GRAPH = {90, 210, 120, 255};
+    static const Color GPU_GRAPH = {90, 160, 250, 255};
+
+    // NOTE: The panel goes first since it is drawn underneath everything else. Its height is only
+    //       known at the end, so its corners are patched in then.
+    vertexCount = 0;
+    addSolid(PANEL_MARGIN, PANEL_MARGIN, PANEL_MARGIN + PANEL_WIDTH, PANEL_MARGIN, PANEL);
+
+    float x = PANEL_MARGIN + PANEL_PADDING;
+    float y = PANEL_MARGIN + PANEL_PADDING;
+    char line[64];
+
+    float frameInterval = average(frameIntervals);
+    snprintf(line, sizeof(line), "FPS %.1f", frameInterval > 0.0f ? 1000.0f / frameInterval : 0.0f);
+    addText(x, y, line, TEXT);
+    y += LINE_HEIGHT;
+
+    snprintf(line, sizeof(line), "CPU %.2f ms (avg %.2f)",
+             cpuTimes.count ? cpuTimes.samples[(cpuTimes.next + HISTORY_LENGTH - 1) % HISTORY_LENGTH] : 0.0f,
+             average(cpuTimes));
+    addText(x, y, line, CPU_GRAPH);
+    y += LINE_HEIGHT;
+    addGraph(x, y, GRAPH_WIDTH, GRAPH_HEIGHT, cpuTimes, FRAME_BUDGET_MS, CPU_GRAPH);
+    y += GRAPH_HEIGHT + 4.0f;
+
+    if(gpuTimes.count)
+    {
+        snprintf(line, sizeof(line), "GPU %.2f ms (avg %.2f)",
+                 gpuTimes.samples[(gpuTimes.next + HISTORY_LENGTH - 1) % HISTORY_LENGTH], average(gpuTimes));
+    }
+    else
+    {
+        snprintf(line, sizeof(line), "GPU n/a");
+    }
+    addText(x, y, line, GPU_GRAPH);
+    y += LINE_HEIGHT;
+    addGraph(x, y, GRAPH_WIDTH, GRAPH_HEIGHT, gpuTimes, FRAME_BUDGET_MS, GPU_GRAPH);
+    y += GRAPH_HEIGHT + 4.0f;
+
+    snprintf(line, sizeof(line), "Draws %u  GL calls %u", stats.drawCalls, stats.glCalls);
+    addText(x, y, line, TEXT);
+    y += LINE_HEIGHT;
+
+    snprintf(line, sizeof(line), "Redundant GL calls %u", stats.redundantGlCalls);
+    addText(x, y, line, TEXT);
+    y += LINE_HEIGHT;
+
+    snprintf(line, sizeof(line), "Triangles %zu", stats.triangles);
+    addText(x, y, line, TEXT);
+    y += LINE_HEIGHT;
+
+    snprintf(line, sizeof(line), "Textures %.1f MB", stats.textureBytes / (1024.0 * 1024.0));
+    addText(x, y, line, TEXT);
+    y += LINE_HEIGHT;
+
+    snprintf(line, sizeof(line), "Alpha +%.1f  Beta +%.1f  Zoom %.0f", stats.alphaIncrement,
+             stats.betaIncrement, stats.zoom);
+    addText(x, y, line, TEXT);
+    y += LINE_HEIGHT;
+
+    float panelBottom = y - LINE_HEIGHT + GLYPH_SIZE + PANEL_PADDING;
+    vertices[1].y = vertices[2].y = vertices[4].y = panelBottom;
+
+    // NOTE: Orphan the buffer like the instance buffer, so this never waits on last frame's draw
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_CULL_FACE);
+    glEnable(GL_BLEND);
+    glUseProgram(program);
+    glUniform2f(screenSizeLocation, (float)width, (float)height);
+    glBindVertexArray(vao);
+    glBindTexture(GL_TEXTURE_2D, fontTexture);
+    glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(Vertex) * vertices.size(), NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(Vertex) * vertexCount, vertices.data());
+    glDrawArrays(GL_TRIANGLES, 0, vertexCount);
+}
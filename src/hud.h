@@ -0,0 +1,106 @@
+#ifndef HUD_H
+#define HUD_H
+
+#include <GL/glew.h>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "shadercache.h"
+
+// What the HUD shows besides the frame time graphs. Counts are those of the previous frame, since
+// the current one is still being drawn.
+struct HudStats
+{
+    unsigned int drawCalls;
+    unsigned int glCalls;
+    unsigned int redundantGlCalls;
+    size_t triangles;
+    size_t textureBytes;
+    float alphaIncrement;
+    float betaIncrement;
+    float zoom;
+};
+
+// Performance overlay drawn on top of the scene: FPS, CPU and GPU frame time graphs, call and
+// triangle counts, texture memory and the current simulation speeds.
+//
+// Text comes from an 8x8 bitmap font that is baked into the executable and uploaded once as a
+// single-channel atlas. Every glyph and graph bar is a textured quad (solid quads sample a cell of
+// the atlas that is fully set), so the whole overlay is built on the CPU into one dynamic vertex
+// buffer and drawn with a single glDrawArrays() call.
+class Hud
+{
+public:
+    static const int HISTORY_LENGTH = 120;
+
+    Hud();
+
+    // Must be called with a current GL context. Leaves the HUD's vertex array bound.
+    void init(ShaderCache& shaderCache);
+    void shutdown();
+
+    void toggle();
+    bool visible();
+
+    // Adds a frame to the graphs. Called every frame, even while hidden, so the graphs are already
+    // filled in when the HUD is shown. gpuTime is -1 when no GPU time was collected this frame.
+    void addFrame(double cpuTime, double gpuTime);
+
+    // Draws the overlay over a width x height viewport. Leaves the HUD's program, vertex array and
+    // font texture bound, with depth testing and face culling disabled and blending enabled.
+    void draw(const HudStats& stats, int width, int height);
+
+private:
+    struct Color
+    {
+        GLubyte r, g, b, a;
+    };
+
+    // Matches the attributes in hud.vert; positions are in pixels from the top-left corner
+    struct Vertex
+    {
+        float x, y;
+        float u, v;
+        Color color;
+    };
+
+    struct History
+    {
+        float samples[HISTORY_LENGTH];
+        int count;
+        int next;
+    };
+
+    // NOTE: Text and graphs take about 600 quads; anything past this is dropped rather than
+    //       growing the buffer mid-run
+    static const int MAX_QUADS = 2048;
+
+    static void push(History& history, float sample);
+    static float average(const History& history);
+
+    void addQuad(float x0, float y0, float x1, float y1, float u0, float v0, float u1, float v1, Color color);
+    void addSolid(float x0, float y0, float x1, float y1, Color color);
+    void addText(float x, float y, const char* text, Color color);
+    void addGraph(float x, float y, float width, float height, const History& history, float budget, Color color);
+
+    bool shown;
+
+    GLuint program;
+    GLuint vao;
+    GLuint vertexBuffer;
+    GLuint fontTexture;
+    GLint screenSizeLocation;
+
+    // Sized once in init(); vertexCount is the number in use this frame
+    std::vector<Vertex> vertices;
+    int vertexCount;
+
+    History cpuTimes;
+    History gpuTimes;
+    History frameIntervals;
+    uint64_t lastFrame;
+};
+
+#endif
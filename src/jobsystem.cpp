@@ -0,0 +1,381 @@
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+#include <vector>
+
+#include "jobsystem.h"
+#include "profiler.h"
+
+using namespace std;
+
+namespace jobsystem
+{
+    // A Chase-Lev work-stealing deque of fixed size (Lê, Pop, Cohen and Zappa Nardelli, "Correct
+    // and Efficient Work-Stealing for Weak Memory Models", 2013). Only the owning thread may
+    // push() and pop(), at the bottom; any thread may steal() from the top.
+    class WorkQueue
+    {
+    public:
+        WorkQueue() : top(0), bottom(0) {}
+
+        // Fails when the queue is full
+        bool push(Job* job)
+        {
+            int64_t b = bottom.load(memory_order_relaxed);
+            int64_t t = top.load(memory_order_acquire);
+            if(b - t >= (int64_t)QUEUE_SIZE)
+            {
+                return false;
+            }
+            jobs[b & (QUEUE_SIZE - 1)].store(job, memory_order_relaxed);
+            bottom.store(b + 1, memory_order_release);
+            return true;
+        }
+
+        Job* pop()
+        {
+            int64_t b = bottom.load(memory_order_relaxed) - 1;
+            bottom.store(b, memory_order_relaxed);
+            atomic_thread_fence(memory_order_seq_cst);
+            int64_t t = top.load(memory_order_relaxed);
+            if(t > b)
+            {
+                bottom.store(b + 1, memory_order_relaxed);
+                return NULL;
+            }
+
+            // NOTE: With one job left a thief may be after it too, and whoever moves top first
+            //       gets it
+            Job* job = jobs[b & (QUEUE_SIZE - 1)].load(memory_order_relaxed);
+            if(t == b)
+            {
+                if(!top.compare_exchange_strong(t, t + 1, memory_order_seq_cst, memory_order_relaxed))
+                {
+                    job = NULL;
+                }
+                bottom.store(b + 1, memory_order_relaxed);
+            }
+            return job;
+        }
+
+        Job* steal()
+        {
+            int64_t t = top.load(memory_order_acquire);
+            atomic_thread_fence(memory_order_seq_cst);
+            int64_t b = bottom.load(memory_order_acquire);
+            if(t >= b)
+            {
+                return NULL;
+            }
+            Job* job = jobs[t & (QUEUE_SIZE - 1)].load(memory_order_relaxed);
+            if(!top.compare_exchange_strong(t, t + 1, memory_order_seq_cst, memory_order_relaxed))
+            {
+                return NULL;
+            }
+            return job;
+        }
+
+    private:
+        // NOTE: Padded apart, since thieves hammer top while the owner works on bottom
+        atomic<int64_t> top;
+        char padding[64];
+        atomic<int64_t> bottom;
+        atomic<Job*> jobs[QUEUE_SIZE];
+    };
+
+    // Everything that belongs to one thread taking part: index 0 is the thread that called
+    // init(), the workers follow
+    struct ThreadState
+    {
+        ThreadState() : nextJob(0)
+        {
+            for(size_t i=0; i<JOB_POOL_SIZE; i++)
+            {
+                pool[i].unfinished.store(0, memory_order_relaxed);
+            }
+        }
+
+        WorkQueue queue;
+        Job pool[JOB_POOL_SIZE];
+        size_t nextJob;
+    };
+
+    // Jobs for threads that don't take part, which run on the spot and so only ever need a few
+    static const size_t INLINE_POOL_SIZE = 64;
+
+    static vector<ThreadState*> states;
+    static vector<thread> workers;
+    static int activeWorkers = 0;
+    static thread_local int threadIndex = -1;
+
+    static mutex backgroundMutex;
+    static deque<Job*> backgroundJobs;
+
+    // NOTE: queuedJobs counts the jobs waiting in any queue, so that workers only go to sleep
+    //       when there is nothing to do. A worker announces itself in sleepingWorkers before
+    //       checking it, and run() queues before checking sleepingWorkers, so one of the two
+    //       always sees the other and no wake-up is lost.
+    static mutex wakeMutex;
+    static condition_variable wakeCondition;
+    static atomic<int> queuedJobs(0);
+    static atomic<int> sleepingWorkers(0);
+    static atomic<bool> stopping(false);
+
+    static void execute(Job* job);
+
+    // NOTE: The parent is read first, since once the count drops to zero the job may be reused
+    //       (or, for the root of a parallelFor(), go out of scope) at any moment
+    static void finish(Job* job)
+    {
+        Job* parent = job->parent;
+        if(job->unfinished.fetch_sub(1, memory_order_acq_rel) == 1 && parent)
+        {
+            finish(parent);
+        }
+    }
+
+    // The next slot in a thread's ring whose job has finished. A job that is still running (a
+    // parent waiting on its children, above all) keeps its slot however many jobs come after it.
+    static Job* takeSlot(Job* pool, size_t poolSize, size_t& next)
+    {
+        for(size_t tried=0; tried<poolSize; tried++)
+        {
+            Job* job = &pool[next++ % poolSize];
+            if(job->unfinished.load(memory_order_acquire) == 0)
+            {
+                return job;
+            }
+        }
+        printf("Job system: more than %zu unfinished jobs on one thread\n", poolSize);
+        abort();
+    }
+
+    static void wakeWorker()
+    {
+        if(sleepingWorkers.load() > 0)
+        {
+            lock_guard<mutex> lock(wakeMutex);
+            wakeCondition.notify_one();
+        }
+    }
+
+    // The calling thread's own jobs first, then other threads' (starting with the next one, so
+    // thieves spread out), then, for workers, the background jobs
+    static Job* findJob(bool includeBackground)
+    {
+        Job* job = states[threadIndex]->queue.pop();
+        for(size_t i=1; !job && i<states.size(); i++)
+        {
+            job = states[(threadIndex + i) % states.size()]->queue.steal();
+        }
+        if(!job && includeBackground)
+        {
+            lock_guard<mutex> lock(backgroundMutex);
+            if(!backgroundJobs.empty())
+            {
+                job = backgroundJobs.front();
+                backgroundJobs.pop_front();
+            }
+        }
+        if(job)
+        {
+            queuedJobs.fetch_sub(1);
+        }
+        return job;
+    }
+
+    static void workerLoop(int index)
+    {
+        threadIndex = index;
+        PROFILE_THREAD_NAME("job worker");
+        while(!stopping.load())
+        {
+            Job* job = findJob(true);
+            if(job)
+            {
+                execute(job);
+                continue;
+            }
+
+            unique_lock<mutex> lock(wakeMutex);
+            sleepingWorkers.fetch_add(1);
+            while(queuedJobs.load() == 0 && !stopping.load())
+            {
+                wakeCondition.wait(lock);
+            }
+            sleepingWorkers.fetch_sub(1);
+        }
+    }
+
+    static void execute(Job* job)
+    {
+        // NOTE: A range job bigger than its grain splits in two and finishes through its halves
+        if(job->grain > 0 && job->end - job->begin > job->grain)
+        {
+            size_t middle = job->begin + (job->end - job->begin) / 2;
+            Job* halves[2] = {allocateJob(job), allocateJob(job)};
+            for(int i=0; i<2; i++)
+            {
+                halves[i]->function = job->function;
+                halves[i]->begin = (i == 0) ? job->begin : middle;
+                halves[i]->end = (i == 0) ? middle : job->end;
+                halves[i]->grain = job->grain;
+                memcpy(halves[i]->data, job->data, JOB_DATA_SIZE);
+            }
+            run(halves[0]);
+            run(halves[1]);
+        }
+        else
+        {
+            job->function(job, job->begin, job->end);
+        }
+        finish(job);
+    }
+
+    void init(int workerCount)
+    {
+        if(workerCount < 0)
+        {
+            workerCount = (int)thread::hardware_concurrency() - 1;
+            workerCount = (workerCount < 1) ? 1 : workerCount;
+        }
+
+        stopping = false;
+        for(int i=0; i<=workerCount; i++)
+        {
+            states.push_back(new ThreadState());
+        }
+        threadIndex = 0;
+        activeWorkers = workerCount;
+        for(int i=1; i<=workerCount; i++)
+        {
+            workers.push_back(thread(workerLoop, i));
+        }
+
+        if(workerCount == 0)
+        {
+            printf("Job system: single-threaded, jobs run in program order\n");
+        }
+        else
+        {
+            printf("Job system: %d worker threads\n", workerCount);
+        }
+    }
+
+    void shutdown()
+    {
+        {
+            lock_guard<mutex> lock(wakeMutex);
+            stopping = true;
+        }
+        wakeCondition.notify_all();
+        for(size_t i=0; i<workers.size(); i++)
+        {
+            workers[i].join();
+        }
+        workers.clear();
+        activeWorkers = 0;
+
+        for(size_t i=0; i<states.size(); i++)
+        {
+            delete states[i];
+        }
+        states.clear();
+        backgroundJobs.clear();
+        queuedJobs = 0;
+        threadIndex = -1;
+    }
+
+    int workerCount()
+    {
+        return activeWorkers;
+    }
+
+    bool parallel()
+    {
+        return threadIndex >= 0 && activeWorkers > 0;
+    }
+
+    Job* allocateJob(Job* parent)
+    {
+        static thread_local Job inlinePool[INLINE_POOL_SIZE];
+        static thread_local size_t nextInlineJob = 0;
+
+        Job* job;
+        if(threadIndex >= 0)
+        {
+            ThreadState* state = states[threadIndex];
+            job = takeSlot(state->pool, JOB_POOL_SIZE, state->nextJob);
+        }
+        else
+        {
+            job = takeSlot(inlinePool, INLINE_POOL_SIZE, nextInlineJob);
+        }
+        prepareJob(job, parent);
+        return job;
+    }
+
+    void prepareJob(Job* job, Job* parent)
+    {
+        job->parent = parent;
+        job->unfinished.store(1, memory_order_relaxed);
+        job->begin = 0;
+        job->end = 0;
+        job->grain = 0;
+        if(parent)
+        {
+            parent->unfinished.fetch_add(1, memory_order_relaxed);
+        }
+    }
+
+    void run(Job* job)
+    {
+        if(!parallel() || !states[threadIndex]->queue.push(job))
+        {
+            execute(job);
+            return;
+        }
+        queuedJobs.fetch_add(1);
+        wakeWorker();
+    }
+
+    void runInBackground(Job* job)
+    {
+        if(activeWorkers == 0)
+        {
+            execute(job);
+            return;
+        }
+        {
+            lock_guard<mutex> lock(backgroundMutex);
+            backgroundJobs.push_back(job);
+        }
+        queuedJobs.fetch_add(1);
+        wakeWorker();
+    }
+
+    void wait(Job* job)
+    {
+        while(!finished(job))
+        {
+            Job* next = parallel() ? findJob(false) : NULL;
+            if(next)
+            {
+                execute(next);
+            }
+            else
+            {
+                this_thread::yield();
+            }
+        }
+    }
+
+    bool finished(const Job* job)
+    {
+        return job->unfinished.load(memory_order_acquire) == 0;
+    }
+}
@@ -0,0 +1,149 @@
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#include <atomic>
+#include <new>
+#include <stddef.h>
+#include <string.h>
+#include <type_traits>
+
+// A work-stealing job system for spreading CPU work over all cores. Every thread that takes part
+// (the one that called init() and the workers) has its own deque of jobs: it pushes and pops
+// its own jobs at the bottom, LIFO, so the most recently split work stays hot in its cache,
+// while idle threads steal from the top of the others' deques, taking the oldest and usually
+// biggest pieces. Waiting for a job helps with the work instead of blocking.
+//
+// Jobs can have a parent, which only counts as finished once all of its children have too, so a
+// whole tree of work can be waited on through its root. parallelFor() builds such a tree itself
+// by splitting its range in halves until the pieces are no bigger than the grain size.
+//
+// Long-running jobs that nobody waits on (loading a texture, say) go through runInBackground()
+// instead. Those sit in one shared FIFO that only the workers take from, so a thread waiting on
+// a short job is never stuck running a long one.
+//
+// Jobs come from a fixed ring of JOB_POOL_SIZE per thread, allocated once in init(), so running
+// jobs never touches the heap. A slot is reused once its job has finished (the ring skips over
+// the ones still running), so nothing should keep a pointer to a finished job, and a thread can't
+// have more than JOB_POOL_SIZE unfinished jobs at a time (it aborts if it does).
+//
+// init(0) starts no workers: every job then runs on the spot, on the thread that runs it and in
+// program order, which makes runs deterministic and stack traces readable when debugging. Threads
+// that didn't call init() and aren't workers (and everything before init()) behave the same way.
+namespace jobsystem
+{
+    // Must be a power of two
+    static const size_t JOB_POOL_SIZE = 4096;
+    static const size_t QUEUE_SIZE = 4096;
+
+    // Bytes a job can hold of the function it runs (its captures, for a lambda)
+    static const size_t JOB_DATA_SIZE = 48;
+
+    struct Job
+    {
+        void (*function)(Job* job, size_t begin, size_t end);
+        Job* parent;
+        std::atomic<int> unfinished;
+
+        // The part of a parallelFor() range this job covers, and how small a part has to get
+        // before it runs rather than splitting further (0 for jobs that never split)
+        size_t begin;
+        size_t end;
+        size_t grain;
+
+        alignas(16) unsigned char data[JOB_DATA_SIZE];
+    };
+
+    // Starts workerCount worker threads, or one less than the number of cores (but at least one)
+    // when workerCount is negative. The calling thread takes part in the work too, while it waits.
+    void init(int workerCount=-1);
+
+    // Stops the workers. Everything that was run must have finished by then.
+    void shutdown();
+
+    int workerCount();
+
+    // False in single-thread mode, before init() and on threads that don't take part
+    bool parallel();
+
+    // Creates a job that calls function() once run, as a child of parent if one is given. The
+    // function is copied into the job and never destroyed, so it should only capture pointers
+    // and plain values.
+    template<typename Function>
+    Job* createJob(const Function& function, Job* parent=NULL);
+
+    // Queues a job on the calling thread (runs it right away if the system isn't parallel)
+    void run(Job* job);
+
+    // Queues a long-running job for the workers only
+    void runInBackground(Job* job);
+
+    // Runs other jobs until job and all of its children have finished
+    void wait(Job* job);
+    bool finished(const Job* job);
+
+    // Calls function(begin, end) over disjoint subranges of [0, count) in parallel, each at most
+    // grain long (except when count fits into one grain, which runs as a single call on the
+    // spot), and returns once all of them have returned
+    template<typename Function>
+    void parallelFor(size_t count, size_t grain, const Function& function);
+
+    // Implementation details for the templates above
+    Job* allocateJob(Job* parent);
+    void prepareJob(Job* job, Job* parent);
+
+    template<typename Function>
+    void callFunction(Job* job, size_t begin, size_t end)
+    {
+        (*(const Function*)job->data)();
+    }
+
+    template<typename Function>
+    void callRange(Job* job, size_t begin, size_t end)
+    {
+        const Function* function;
+        memcpy(&function, job->data, sizeof(function));
+        (*function)(begin, end);
+    }
+}
+
+template<typename Function>
+jobsystem::Job* jobsystem::createJob(const Function& function, Job* parent)
+{
+    static_assert(sizeof(Function) <= JOB_DATA_SIZE, "Job function too big, capture less");
+    static_assert(std::is_trivially_destructible<Function>::value, "Job functions are never destroyed");
+    Job* job = allocateJob(parent);
+    job->function = &callFunction<Function>;
+    new(job->data) Function(function);
+    return job;
+}
+
+template<typename Function>
+void jobsystem::parallelFor(size_t count, size_t grain, const Function& function)
+{
+    grain = (grain < 1) ? 1 : grain;
+    if(count <= grain || !parallel())
+    {
+        if(count > 0)
+        {
+            function((size_t)0, count);
+        }
+        return;
+    }
+
+    // NOTE: The root lives on the stack rather than in the pool, since this is the one place
+    //       that waits on a job: a pooled root could be reused by a job this thread runs while
+    //       waiting, right after it finished and before the wait noticed. The jobs only keep a
+    //       pointer to the function, which is fine since it outlives them too.
+    Job root;
+    prepareJob(&root, NULL);
+    const Function* pointer = &function;
+    root.function = &callRange<Function>;
+    memcpy(root.data, &pointer, sizeof(pointer));
+    root.begin = 0;
+    root.end = count;
+    root.grain = grain;
+    run(&root);
+    wait(&root);
+}
+
+#endif
@@ -1,5 +1,75 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include "SDL.h"
+#include "alloctracker.h"
+#include "benchmark.h"
+#include "framepacer.h"
 #include "glwindow.h"
+#include "glhooks.h"
+#include "jobsystem.h"
+#include "perfcounters.h"
+#include "profiler.h"
+#include "simulationthread.h"
+
+// Frames to render after the textures finished streaming in before any frame that allocates counts
+// as a failure (only checked in ALLOC_TRACKING builds)
+static const int ALLOC_WARMUP_FRAMES = 30;
+
+// Frames after setup that --gl-trace records
+static const int GL_TRACE_FRAMES = 120;
+
+// How long an idle on-demand loop waits for events before checking on things again
+static const int IDLE_WAIT_MS = 500;
+
+// Why the next frame has to be drawn in on-demand mode
+enum RedrawReason
+{
+    REDRAW_SIMULATION = 1 << 0,
+    REDRAW_CAMERA = 1 << 1,
+    REDRAW_HUD = 1 << 2,
+    REDRAW_WINDOW = 1 << 3,
+    REDRAW_STREAMING = 1 << 4
+};
+
+// The inputs the last frame was drawn with, so that on-demand mode can tell when they change
+struct DrawnInputs
+{
+    float theta;
+    float phi;
+    float zoom;
+    float alphaIncrement;
+    float betaIncrement;
+    bool hudShown;
+};
+
+static void printUsage(const char* program)
+{
+    printf("Usage: %s [options]\n", program);
+    printf("  --headless          Render offscreen, without a visible window\n");
+    printf("  --size WxH          Resolution to render at (default 640x480)\n");
+    printf("  --no-vsync          Don't wait for vertical sync when presenting, and don't cap the frame rate\n");
+    printf("  --fps N             Pace frames to N per second instead of vertical sync\n");
+    printf("  --frames N          Exit after rendering N frames\n");
+    printf("  --capture DIR       Write every frame to DIR/frame_NNNNN.ppm\n");
+    printf("  --hud               Start with the performance HUD shown (toggle with F1)\n");
+    printf("  --on-demand         Only draw a frame when something on screen changed, and sleep otherwise\n");
+    printf("  --jobs N            Run N job system workers (default one per core besides the main thread);\n");
+    printf("                      0 runs every job on the spot, in program order, for debugging\n");
+    printf("  --gl-leak-check N   Abort when the number of live GL objects grows on N frames in a row\n");
+    printf("  --gl-trace FILE     Write GL state changes and draws during setup and the first %d frames\n", GL_TRACE_FRAMES);
+    printf("                      to FILE as a binary trace\n");
+    printf("  --gl-trace-dump FILE\n");
+    printf("                      Print a trace written by --gl-trace and exit\n");
+    printf("  --gl-call-budget N  Report GL calls per frame at exit; benchmark runs exit with 4 if any\n");
+    printf("                      measured frame made more than N\n");
+    printf("  --bench N           Render N frames along scripted camera paths and report frame times\n");
+    printf("  --bench-report FILE Write the benchmark report to FILE (default bench_report.json)\n");
+    printf("  --bench-baseline FILE\n");
+    printf("                      Compare the benchmark against FILE, exiting with 2 on a regression\n");
+    printf("  --bench-threshold PCT\n");
+    printf("                      Allowed slowdown against the baseline in percent (default 10)\n");
+}
 
 // In order to make cross-platform development and deployment easy, SDL implements its own main
 // function, and instead calls out to our code at this SDL_main, however on linux this is not
@@ -11,26 +81,216 @@ int main(int argc, char** argv)
 int SDL_main(int argc, char** argv)
 #endif
 {
+    WindowSettings settings;
+    int frameLimit = 0;
+    int benchFrames = 0;
+    double targetFps = 0.0;
+    bool onDemand = false;
+    int jobWorkers = -1;
+    const char* benchReport = "bench_report.json";
+    const char* benchBaseline = NULL;
+    double benchThreshold = 10.0;
+    const char* glTrace = NULL;
+    unsigned int glCallBudget = 0;
+    for(int i=1; i<argc; i++)
+    {
+        if(strcmp(argv[i], "--headless") == 0)
+        {
+            settings.headless = true;
+        }
+        else if(strcmp(argv[i], "--size") == 0 && i+1 < argc &&
+                sscanf(argv[i+1], "%dx%d", &settings.width, &settings.height) == 2)
+        {
+            i++;
+        }
+        else if(strcmp(argv[i], "--no-vsync") == 0)
+        {
+            settings.vsync = false;
+        }
+        else if(strcmp(argv[i], "--fps") == 0 && i+1 < argc)
+        {
+            targetFps = atof(argv[++i]);
+            settings.vsync = false;
+        }
+        else if(strcmp(argv[i], "--frames") == 0 && i+1 < argc)
+        {
+            frameLimit = atoi(argv[++i]);
+        }
+        else if(strcmp(argv[i], "--capture") == 0 && i+1 < argc)
+        {
+            settings.captureDirectory = argv[++i];
+        }
+        else if(strcmp(argv[i], "--hud") == 0)
+        {
+            settings.showHud = true;
+        }
+        else if(strcmp(argv[i], "--on-demand") == 0)
+        {
+            onDemand = true;
+        }
+        else if(strcmp(argv[i], "--jobs") == 0 && i+1 < argc)
+        {
+            jobWorkers = atoi(argv[++i]);
+            jobWorkers = (jobWorkers < 0) ? 0 : jobWorkers;
+        }
+        else if(strcmp(argv[i], "--gl-leak-check") == 0 && i+1 < argc)
+        {
+            glhooks::setLeakCheck(atoi(argv[++i]));
+        }
+        else if(strcmp(argv[i], "--gl-trace") == 0 && i+1 < argc)
+        {
+            glTrace = argv[++i];
+        }
+        else if(strcmp(argv[i], "--gl-trace-dump") == 0 && i+1 < argc)
+        {
+            return glhooks::dumpTrace(argv[i+1]) ? 0 : 1;
+        }
+        else if(strcmp(argv[i], "--gl-call-budget") == 0 && i+1 < argc)
+        {
+            glCallBudget = (unsigned int)atoi(argv[++i]);
+            glhooks::setCallBudget(glCallBudget);
+        }
+        else if(strcmp(argv[i], "--bench") == 0 && i+1 < argc)
+        {
+            benchFrames = atoi(argv[++i]);
+        }
+        else if(strcmp(argv[i], "--bench-report") == 0 && i+1 < argc)
+        {
+            benchReport = argv[++i];
+        }
+        else if(strcmp(argv[i], "--bench-baseline") == 0 && i+1 < argc)
+        {
+            benchBaseline = argv[++i];
+        }
+        else if(strcmp(argv[i], "--bench-threshold") == 0 && i+1 < argc)
+        {
+            benchThreshold = atof(argv[++i]);
+        }
+        else
+        {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    // NOTE: Benchmark runs measure the renderer, not the display, so never wait for vsync (or for
+    //       the frame pacer), and don't let texture streaming skew the numbers
+    FrameBenchmark benchmark(benchFrames, 60);
+    if(benchFrames > 0)
+    {
+        settings.vsync = false;
+        targetFps = 0.0;
+        onDemand = false;
+        settings.waitForTextures = true;
+        frameLimit = benchmark.totalFrames();
+    }
+
+    // NOTE: Without any display server (e.g. on a build agent) a hidden X11/Wayland window can't be
+    //       created either, so fall back to SDL's offscreen driver, which gets its GL context
+    //       straight from EGL (and works with Mesa's llvmpipe on machines without a GPU)
+    if(settings.headless && !SDL_getenv("DISPLAY") && !SDL_getenv("WAYLAND_DISPLAY") &&
+       !SDL_getenv("SDL_VIDEODRIVER"))
+    {
+        SDL_SetHint(SDL_HINT_VIDEODRIVER, "offscreen");
+    }
+
+    // NOTE: Captures are meant to contain every frame
+    onDemand = onDemand && settings.captureDirectory.empty();
+
     if(SDL_Init(SDL_INIT_VIDEO) != 0)
     {
         SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_INFORMATION, "Error", "Unable to initialize SDL", 0);
         return 1;
     }
 
+    profiler::init();
+    perfcounters::init();
+    jobsystem::init(jobWorkers);
+
+    if(glTrace)
+    {
+        glhooks::startTrace(glTrace, GL_TRACE_FRAMES);
+    }
+
     OpenGLWindow window;
-    window.initGL();
+    window.initGL(settings);
     
-    float beta = 0.0f, alpha = 0.0f, theta = 0.0f, phi = 0.0f;
+    // NOTE: When vsync was asked for but the driver refused it, frames are paced to the display's
+    //       refresh rate instead. Headless runs have no display to keep up with and run uncapped
+    //       unless given --fps.
+    FramePacer pacer;
+    if(targetFps > 0.0)
+    {
+        pacer.setMode(FramePacer::FIXED_RATE, targetFps);
+    }
+    else if(window.vsyncActive())
+    {
+        pacer.setMode(FramePacer::VSYNC);
+    }
+    else if(settings.vsync && !settings.headless)
+    {
+        pacer.setMode(FramePacer::FIXED_RATE, window.refreshRate());
+    }
+    else
+    {
+        pacer.setMode(FramePacer::UNCAPPED);
+    }
+
+    // NOTE: Constructed after initGL() so that loading doesn't count as simulated time.
+    //       Captured frames are meant to come out the same on every run, so there the
+    //       simulation doesn't get its own thread and advances exactly one step per frame.
+    //       Benchmark runs render their own scripted state and don't need it at all.
+    SimulationThread simulation;
+    bool lockstep = !settings.captureDirectory.empty();
+    if(!lockstep && benchFrames == 0)
+    {
+        simulation.start();
+    }
+    float theta = 0.0f, phi = 0.0f;
     float betaIncrement = 4.0f, alphaIncrement = 1.0f;
     bool running = true, pause = true;
+    float postedAlphaIncrement = 0.0f, postedBetaIncrement = 0.0f;
+    bool postedPause = false, simulationRunning = false;
     float zoom = 150.0f, x = 0.0f, y = 0.0f;
+    int frameCount = 0;
+    int steadyFrames = 0;
+    unsigned int steadyStateAllocations = 0;
+    unsigned int redraw = REDRAW_WINDOW;
+    DrawnInputs drawn = {};
     while(running)
     {
-        // Check for a quit event before passing to the GLWindow
-        
+        pacer.beginFrame();
+
+        // NOTE: In on-demand mode, with nothing to redraw and nothing moving on its own, the loop
+        //       sleeps here until an event arrives. The wait isn't part of any frame, so the frame
+        //       begun above is dropped and started again once it's over; should the wake-up turn
+        //       out to have nothing to redraw either, that one is skipped further down.
         SDL_Event e;
-        while(SDL_PollEvent(&e))
+        bool haveEvent;
+        if(onDemand && redraw == 0 && !simulationRunning && !window.texturesLoading())
+        {
+            {
+                PROFILE_ZONE("idle");
+                haveEvent = (SDL_WaitEventTimeout(&e, IDLE_WAIT_MS) != 0);
+            }
+            pacer.skipFrame();
+            pacer.beginFrame();
+        }
+        else
+        {
+            haveEvent = (SDL_PollEvent(&e) != 0);
+        }
+
+        // Check for a quit event before passing to the GLWindow
+        PROFILE_ZONE_BEGIN("events");
+        for(; haveEvent; haveEvent = (SDL_PollEvent(&e) != 0))
         {
+            // Exposed, resized, restored, ... all need the window contents drawn again
+            if(e.type == SDL_WINDOWEVENT)
+            {
+                redraw |= REDRAW_WINDOW;
+            }
+
             if(e.type == SDL_QUIT)
             {
                 running = false;
@@ -67,6 +327,12 @@ int SDL_main(int argc, char** argv)
                     case SDLK_z: 
                         phi += 1.0f;
                         break;
+                    case SDLK_F1:
+                        window.toggleHud();
+                        break;
+                    case SDLK_F9:
+                        profiler::requestCapture();
+                        break;
                 }
             }
             else if (e.type == SDL_MOUSEWHEEL)
@@ -80,22 +346,170 @@ int SDL_main(int argc, char** argv)
             }
             
         }
+        PROFILE_ZONE_END("events");
+
         alphaIncrement = alphaIncrement < 1.0f ? 1.0f : alphaIncrement;
         betaIncrement = betaIncrement <= alphaIncrement ? alphaIncrement + 1.0f : betaIncrement;
-        window.render(alpha, beta, theta, phi, zoom);
-        if(!pause || alpha == 0.0f) // Only update alpha and beta if animation is running
-        {                        
-            alpha += alphaIncrement;
-            beta += betaIncrement;
+        window.setSimulationSpeed(alphaIncrement, betaIncrement);
+
+        // NOTE: Only changes are sent, and one that doesn't fit into the queue is simply sent
+        //       again next frame
+        if(alphaIncrement != postedAlphaIncrement || betaIncrement != postedBetaIncrement)
+        {
+            if(simulation.post(SimulationCommand::setSpeed(alphaIncrement, betaIncrement)))
+            {
+                postedAlphaIncrement = alphaIncrement;
+                postedBetaIncrement = betaIncrement;
+            }
+        }
+        if(pause != postedPause && simulation.post(SimulationCommand::setPaused(pause)))
+        {
+            postedPause = pause;
         }
-        
+        if(lockstep)
+        {
+            simulation.update(SimulationClock::STEP_SECONDS);
+        }
+        const SimulationSnapshot& snapshot = simulation.latest();
 
-        // We sleep for 10ms here so as to prevent excessive CPU usage
-        SDL_Delay(10);
+        // NOTE: The simulation thread picks up a command within a step, so until the snapshot
+        //       catches up the main thread's own pause state counts too
+        simulationRunning = !pause || !snapshot.clock.paused();
+
+        if(theta != drawn.theta || phi != drawn.phi || zoom != drawn.zoom)
+        {
+            redraw |= REDRAW_CAMERA;
+        }
+        if(simulationRunning)
+        {
+            redraw |= REDRAW_SIMULATION;
+        }
+        if(window.hudVisible() != drawn.hudShown ||
+           (drawn.hudShown && (alphaIncrement != drawn.alphaIncrement || betaIncrement != drawn.betaIncrement)))
+        {
+            redraw |= REDRAW_HUD;
+        }
+        if(window.texturesLoading())
+        {
+            redraw |= REDRAW_STREAMING;
+        }
+        // NOTE: Idle iterations still mark a profiler frame, which is also where requested traces
+        //       (F9, SIGUSR1) get written. They close the allocation frame too, without checking
+        //       it, so that whatever event handling and waiting allocated isn't charged to the
+        //       next frame that is actually drawn.
+        if(onDemand && redraw == 0)
+        {
+            pacer.skipFrame();
+            PROFILE_FRAME();
+            alloctracker::endFrame();
+            continue;
+        }
+
+        if(benchFrames > 0)
+        {
+            BenchmarkState state = benchmark.state(frameCount);
+            Uint64 start = SDL_GetPerformanceCounter();
+            window.render(state.alpha, state.beta, state.theta, state.phi, state.zoom);
+            double cpuTime = 1000.0 * (SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+            benchmark.record(frameCount, cpuTime, window.gpuFrameTime(), glhooks::lastFrameCallCount(),
+                             glhooks::lastFrameRedundantCount());
+        }
+        else
+        {
+            OrbitState orbit = snapshot.interpolated();
+            window.render((float)orbit.alpha, (float)orbit.beta, theta, phi, zoom);
+        }
+        redraw = 0;
+        drawn.theta = theta;
+        drawn.phi = phi;
+        drawn.zoom = zoom;
+        drawn.alphaIncrement = alphaIncrement;
+        drawn.betaIncrement = betaIncrement;
+        drawn.hudShown = window.hudVisible();
+        PROFILE_COUNTER("GL calls", glhooks::lastFrameCallCount());
+        PROFILE_COUNTER("Redundant GL calls", glhooks::lastFrameRedundantCount());
+        PROFILE_FRAME();
+
+        // NOTE: Once everything is loaded a frame has no reason to touch the heap. Interactive
+        //       runs stop right at the first frame that does, benchmark runs fail at the end.
+        alloctracker::endFrame();
+        steadyFrames = window.texturesLoading() ? 0 : steadyFrames + 1;
+        if(steadyFrames > ALLOC_WARMUP_FRAMES && alloctracker::lastFrameAllocations() > 0)
+        {
+            printf("Frame %d made %u heap allocations (%zu bytes) after warm-up:\n", frameCount,
+                   alloctracker::lastFrameAllocations(), alloctracker::lastFrameBytes());
+            alloctracker::printLastFrameSites();
+            steadyStateAllocations += alloctracker::lastFrameAllocations();
+            if(benchFrames == 0)
+            {
+                abort();
+            }
+        }
+        frameCount++;
+        if(frameLimit > 0 && frameCount >= frameLimit)
+        {
+            running = false;
+        }
+
+        pacer.endFrame();
+    }
+
+    simulation.stop();
+    glhooks::stopTrace();
+
+    const GpuProfiler& profiler = window.gpuProfiler();
+    for(int scope=0; scope<profiler.scopeCount(); scope++)
+    {
+        benchmark.addGpuScope(profiler.scopeName(scope), profiler.averageTime(scope), profiler.maxTime(scope));
+    }
+    for(int i=0; i<perfcounters::regionCount(); i++)
+    {
+        const perfcounters::RegionStats& region = perfcounters::region(i);
+        double elements = (double)region.elements;
+        benchmark.addPerfRegion(region.name, (double)region.calls, elements,
+                                perfcounters::instructionsPerCycle(region.totals),
+                                perfcounters::perElement(region.totals, perfcounters::CYCLES, elements),
+                                perfcounters::perElement(region.totals, perfcounters::CACHE_MISSES, elements),
+                                perfcounters::perElement(region.totals, perfcounters::BRANCH_MISSES, elements));
     }
 
     window.cleanup();
+    jobsystem::shutdown();
     SDL_Quit();
-    return 0;
+
+    if(alloctracker::enabled())
+    {
+        alloctracker::printReport();
+    }
+    perfcounters::printReport();
+    perfcounters::shutdown();
+    pacer.printReport();
+    if(benchFrames > 0 || glCallBudget > 0)
+    {
+        glhooks::printBudgetReport();
+    }
+
+    int result = 0;
+    if(benchFrames > 0)
+    {
+        printf("%s", benchmark.report().c_str());
+        benchmark.writeReport(benchReport);
+        if(benchBaseline && !benchmark.compareWithBaseline(benchBaseline, benchThreshold))
+        {
+            printf("Frame times regressed by more than %.1f%% against %s\n", benchThreshold, benchBaseline);
+            result = 2;
+        }
+        if(steadyStateAllocations > 0)
+        {
+            printf("Steady-state frames made %u heap allocations\n", steadyStateAllocations);
+            result = 3;
+        }
+        if(glCallBudget > 0 && benchmark.maxGlCalls() > glCallBudget)
+        {
+            printf("A frame made %u GL calls, over the budget of %u\n", benchmark.maxGlCalls(), glCallBudget);
+            result = 4;
+        }
+    }
+    return result;
 }
 
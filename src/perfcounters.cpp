@@ -0,0 +1,366 @@
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#if defined(PERF_COUNTERS) && defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#define PERF_COUNTERS_LINUX
+#endif
+
+#include "perfcounters.h"
+
+namespace perfcounters
+{
+    const char* counterNames[COUNTER_COUNT] = {"cycles", "instructions", "cache_misses", "branch_misses"};
+
+    double instructionsPerCycle(const Values& totals)
+    {
+        if(!available(CYCLES) || !available(INSTRUCTIONS) || totals.counts[CYCLES] == 0)
+        {
+            return -1.0;
+        }
+        return (double)totals.counts[INSTRUCTIONS] / totals.counts[CYCLES];
+    }
+
+    double perElement(const Values& totals, Counter counter, double elements)
+    {
+        if(!available(counter) || elements <= 0.0)
+        {
+            return -1.0;
+        }
+        return totals.counts[counter] / elements;
+    }
+
+    std::string counterJSON(double value)
+    {
+        if(value < 0.0)
+        {
+            return "null";
+        }
+        char buffer[32];
+        snprintf(buffer, sizeof(buffer), "%.4f", value);
+        return buffer;
+    }
+}
+
+#ifndef PERF_COUNTERS_LINUX
+
+namespace perfcounters
+{
+    bool init()
+    {
+#ifdef PERF_COUNTERS
+        printf("Hardware performance counters are only supported on Linux\n");
+#endif
+        return false;
+    }
+
+    void shutdown()
+    {
+    }
+
+    bool active()
+    {
+        return false;
+    }
+
+    bool available(Counter counter)
+    {
+        return false;
+    }
+
+    void setRegionsEnabled(bool enabled)
+    {
+    }
+
+    bool read(Values& values)
+    {
+        return false;
+    }
+
+    Region::Region(const char* name)
+        : name(name), started(false)
+    {
+    }
+
+    void Region::end(uint64_t elements)
+    {
+    }
+
+    int regionCount()
+    {
+        return 0;
+    }
+
+    const RegionStats& region(int index)
+    {
+        static RegionStats none = {};
+        return none;
+    }
+
+    void printReport()
+    {
+    }
+}
+
+#else
+
+namespace perfcounters
+{
+    static const int MAX_REGIONS = 32;
+
+    static const uint64_t EVENT_CONFIGS[COUNTER_COUNT] =
+    {
+        PERF_COUNT_HW_CPU_CYCLES,
+        PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_MISSES,
+        PERF_COUNT_HW_BRANCH_MISSES
+    };
+
+    // Layout of a group read with PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+    // PERF_FORMAT_TOTAL_TIME_RUNNING: one value per opened counter, in the order they were opened
+    struct GroupReading
+    {
+        uint64_t counterCount;
+        uint64_t timeEnabled;
+        uint64_t timeRunning;
+        uint64_t values[COUNTER_COUNT];
+    };
+
+    static int groupFd = -1;
+    static int counterFds[COUNTER_COUNT] = {-1, -1, -1, -1};
+    static int readIndex[COUNTER_COUNT] = {-1, -1, -1, -1};
+    static int openedCount = 0;
+    static thread_local bool countingThread = false;
+    static bool regionsEnabled = true;
+
+    static RegionStats regions[MAX_REGIONS];
+    static int regionsUsed = 0;
+
+    static int openCounter(Counter counter)
+    {
+        perf_event_attr attributes;
+        memset(&attributes, 0, sizeof(attributes));
+        attributes.size = sizeof(attributes);
+        attributes.type = PERF_TYPE_HARDWARE;
+        attributes.config = EVENT_CONFIGS[counter];
+        attributes.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        // NOTE: The group leader starts disabled so that all the counters start together once the
+        //       group is complete. User space only, which is all perf_event_paranoid=2 allows.
+        attributes.disabled = (groupFd < 0) ? 1 : 0;
+        attributes.exclude_kernel = 1;
+        attributes.exclude_hv = 1;
+        // pid 0 and cpu -1: the calling thread, on whichever CPU it runs
+        return (int)syscall(__NR_perf_event_open, &attributes, 0, -1, groupFd, 0);
+    }
+
+    bool init()
+    {
+        if(groupFd >= 0)
+        {
+            return true;
+        }
+
+        int openError = 0;
+        for(int counter=0; counter<COUNTER_COUNT; counter++)
+        {
+            int fd = openCounter((Counter)counter);
+            if(fd < 0)
+            {
+                openError = errno;
+                continue;
+            }
+            if(groupFd < 0)
+            {
+                groupFd = fd;
+            }
+            counterFds[counter] = fd;
+            readIndex[counter] = openedCount++;
+        }
+
+        if(groupFd < 0)
+        {
+            printf("Hardware performance counters are unavailable: %s", strerror(openError));
+            if(openError == EACCES || openError == EPERM)
+            {
+                printf(" (see /proc/sys/kernel/perf_event_paranoid)");
+            }
+            else if(openError == ENOENT || openError == EOPNOTSUPP)
+            {
+                printf(" (no hardware PMU, e.g. in a VM)");
+            }
+            printf("\n");
+            return false;
+        }
+        for(int counter=0; counter<COUNTER_COUNT; counter++)
+        {
+            if(counterFds[counter] < 0)
+            {
+                printf("Hardware performance counter %s is unavailable\n", counterNames[counter]);
+            }
+        }
+
+        ioctl(groupFd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(groupFd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        countingThread = true;
+        return true;
+    }
+
+    void shutdown()
+    {
+        for(int counter=0; counter<COUNTER_COUNT; counter++)
+        {
+            if(counterFds[counter] >= 0)
+            {
+                close(counterFds[counter]);
+            }
+            counterFds[counter] = -1;
+            readIndex[counter] = -1;
+        }
+        groupFd = -1;
+        openedCount = 0;
+        countingThread = false;
+    }
+
+    bool active()
+    {
+        return groupFd >= 0;
+    }
+
+    bool available(Counter counter)
+    {
+        return readIndex[counter] >= 0;
+    }
+
+    void setRegionsEnabled(bool enabled)
+    {
+        regionsEnabled = enabled;
+    }
+
+    bool read(Values& values)
+    {
+        GroupReading reading;
+        if(groupFd < 0 || ::read(groupFd, &reading, sizeof(reading)) <= 0)
+        {
+            return false;
+        }
+
+        // NOTE: With more events than hardware counters the kernel time-slices them, and each
+        //       count only covers the fraction of the time the group was actually scheduled
+        double scale = 1.0;
+        if(reading.timeRunning > 0 && reading.timeRunning < reading.timeEnabled)
+        {
+            scale = (double)reading.timeEnabled / reading.timeRunning;
+        }
+        for(int counter=0; counter<COUNTER_COUNT; counter++)
+        {
+            int index = readIndex[counter];
+            values.counts[counter] = (index >= 0) ? (uint64_t)(reading.values[index] * scale) : 0;
+        }
+        return true;
+    }
+
+    static RegionStats* findRegion(const char* name)
+    {
+        for(int i=0; i<regionsUsed; i++)
+        {
+            if(regions[i].name == name || strcmp(regions[i].name, name) == 0)
+            {
+                return &regions[i];
+            }
+        }
+        if(regionsUsed == MAX_REGIONS)
+        {
+            return NULL;
+        }
+        RegionStats& stats = regions[regionsUsed++];
+        memset(&stats, 0, sizeof(stats));
+        stats.name = name;
+        return &stats;
+    }
+
+    Region::Region(const char* name)
+        : name(name), started(false)
+    {
+        started = regionsEnabled && countingThread && read(start);
+    }
+
+    void Region::end(uint64_t elements)
+    {
+        Values now;
+        if(!started || !read(now))
+        {
+            return;
+        }
+        started = false;
+
+        RegionStats* stats = findRegion(name);
+        if(!stats)
+        {
+            return;
+        }
+        stats->calls++;
+        stats->elements += elements;
+        for(int counter=0; counter<COUNTER_COUNT; counter++)
+        {
+            stats->totals.counts[counter] += now.counts[counter] - start.counts[counter];
+        }
+    }
+
+    int regionCount()
+    {
+        return regionsUsed;
+    }
+
+    const RegionStats& region(int index)
+    {
+        return regions[index];
+    }
+
+    static void printPerElement(double value)
+    {
+        if(value < 0.0)
+        {
+            printf(" %14s", "n/a");
+        }
+        else
+        {
+            printf(" %14.2f", value);
+        }
+    }
+
+    void printReport()
+    {
+        if(regionsUsed == 0)
+        {
+            return;
+        }
+        printf("Performance counters per region (cycles and misses are per element):\n");
+        printf("  %-20s %8s %12s %6s %14s %14s %14s\n", "region", "calls", "elements", "IPC",
+               "cycles", "cache misses", "branch misses");
+        for(int i=0; i<regionsUsed; i++)
+        {
+            const RegionStats& stats = regions[i];
+            double ipc = instructionsPerCycle(stats.totals);
+            printf("  %-20s %8llu %12llu", stats.name, (unsigned long long)stats.calls,
+                   (unsigned long long)stats.elements);
+            if(ipc < 0.0)
+            {
+                printf(" %6s", "n/a");
+            }
+            else
+            {
+                printf(" %6.2f", ipc);
+            }
+            printPerElement(perElement(stats.totals, CYCLES, (double)stats.elements));
+            printPerElement(perElement(stats.totals, CACHE_MISSES, (double)stats.elements));
+            printPerElement(perElement(stats.totals, BRANCH_MISSES, (double)stats.elements));
+            printf("\n");
+        }
+    }
+}
+
+#endif
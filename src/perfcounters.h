@@ -0,0 +1,87 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <stdint.h>
+#include <string>
+
+// Hardware performance counters (cycles, instructions, cache misses and branch misses) around
+// named regions of CPU-side code, read through Linux's perf_event_open(). Only active in builds
+// with -DPERF_COUNTERS on Linux (make PERF_COUNTERS=1; the microbenchmarks always have it).
+//
+// The counters are opened as one group for the thread that calls init(), so they are always read
+// together and only that thread's work is counted; regions entered on other threads are ignored.
+// When the kernel refuses (perf_event_paranoid, containers, VMs without a virtual PMU, ...) init()
+// says why and returns false, and everything else quietly does nothing. Counters that can't be
+// opened on their own (e.g. no cache miss event on this CPU) are reported as unavailable while
+// the rest still work.
+namespace perfcounters
+{
+    enum Counter
+    {
+        CYCLES,
+        INSTRUCTIONS,
+        CACHE_MISSES,
+        BRANCH_MISSES,
+        COUNTER_COUNT
+    };
+
+    extern const char* counterNames[COUNTER_COUNT];
+
+    struct Values
+    {
+        uint64_t counts[COUNTER_COUNT];
+    };
+
+    bool init();
+    void shutdown();
+
+    bool active();
+    bool available(Counter counter);
+
+    // Regions are counted by default. Each one costs two read() syscalls, which matters for tiny
+    // kernels, so code that measures around them itself (like the microbenchmarks) turns them off.
+    void setRegionsEnabled(bool enabled);
+
+    // Reads the current counts (scaled up if the kernel had to multiplex the counters). Returns
+    // false when the counters aren't active.
+    bool read(Values& values);
+
+    // Counts the work between construction and end() towards the region called name, which must
+    // be a string literal (or otherwise outlive the process). elements is the number of items the
+    // work processed, e.g. faces parsed or bodies updated, for the per-element figures below.
+    class Region
+    {
+    public:
+        explicit Region(const char* name);
+        void end(uint64_t elements);
+
+    private:
+        const char* name;
+        bool started;
+        Values start;
+    };
+
+    struct RegionStats
+    {
+        const char* name;
+        uint64_t calls;
+        uint64_t elements;
+        Values totals;
+    };
+
+    int regionCount();
+    const RegionStats& region(int index);
+
+    // Instructions per cycle and counts per element of a set of totals; -1 when the counters
+    // involved are unavailable or nothing was counted
+    double instructionsPerCycle(const Values& totals);
+    double perElement(const Values& totals, Counter counter, double elements);
+
+    // One of the results above as a JSON value for the reports, with null for unavailable
+    std::string counterJSON(double value);
+
+    // Prints a table of every region
+    void printReport();
+}
+
+#endif
@@ -0,0 +1,248 @@
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <stdio.h>
+#include <signal.h>
+#include <vector>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define PROFILER_USE_TSC
+#elif defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#define PROFILER_USE_TSC
+#endif
+
+#include "profiler.h"
+
+using namespace std;
+
+namespace profiler
+{
+    struct Event
+    {
+        const char* name;
+        int64_t time;
+        double value;
+        EventType type;
+    };
+
+    // Only the owning thread writes to a buffer. Buffers are never freed, so that the events of
+    // threads that have already exited still make it into the trace.
+    struct ThreadBuffer
+    {
+        Event events[EVENTS_PER_THREAD];
+        atomic<uint32_t> next;
+        int id;
+        const char* name;
+    };
+
+    static mutex registryMutex;
+    static vector<ThreadBuffer*> registry;
+    static volatile sig_atomic_t capturePending = 0;
+    static int captureCount = 0;
+
+    static int64_t steadyNanoseconds()
+    {
+        return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // NOTE: Reading the time stamp counter costs about half as much as steady_clock::now(), which
+    //       matters when every zone reads it twice. Ticks are converted to time when a trace is
+    //       written, calibrated against steady_clock over the whole time since init(). This
+    //       assumes an invariant TSC, which every x86 CPU of the last decade or so has.
+    static int64_t now()
+    {
+#ifdef PROFILER_USE_TSC
+        return (int64_t)__rdtsc();
+#else
+        return steadyNanoseconds();
+#endif
+    }
+
+    static int64_t calibrationTicks = 0;
+    static int64_t calibrationNanoseconds = 0;
+
+    static ThreadBuffer* threadBuffer()
+    {
+        static thread_local ThreadBuffer* buffer = NULL;
+        if(!buffer)
+        {
+            buffer = new ThreadBuffer();
+            buffer->next.store(0, memory_order_relaxed);
+            buffer->name = NULL;
+
+            lock_guard<mutex> lock(registryMutex);
+            buffer->id = (int)registry.size() + 1;
+            registry.push_back(buffer);
+        }
+        return buffer;
+    }
+
+#ifndef _WIN32
+    static void handleSignal(int)
+    {
+        requestCapture();
+    }
+#endif
+
+    void init()
+    {
+        calibrationTicks = now();
+        calibrationNanoseconds = steadyNanoseconds();
+#ifndef _WIN32
+        signal(SIGUSR1, handleSignal);
+#endif
+        setThreadName("main");
+    }
+
+    void setThreadName(const char* name)
+    {
+        threadBuffer()->name = name;
+    }
+
+    void record(EventType type, const char* name, double value)
+    {
+        ThreadBuffer* buffer = threadBuffer();
+        uint32_t index = buffer->next.load(memory_order_relaxed);
+        Event& event = buffer->events[index & (EVENTS_PER_THREAD - 1)];
+        event.name = name;
+        event.time = now();
+        event.value = value;
+        event.type = type;
+        buffer->next.store(index + 1, memory_order_release);
+    }
+
+    void frameMark()
+    {
+        record(FRAME_MARK, "frame");
+        if(capturePending)
+        {
+            capturePending = 0;
+            char filename[64];
+            snprintf(filename, sizeof(filename), "profile_trace_%03d.json", captureCount++);
+            if(writeTrace(filename))
+            {
+                cout << "Wrote profiler trace to " << filename << endl;
+            }
+        }
+    }
+
+    void requestCapture()
+    {
+#ifdef PROFILER_DISABLED
+        // NOTE: write() rather than stdio, since this may run inside the SIGUSR1 handler
+        static const char message[] = "Profiler is compiled out (build with PROFILER=1)\n";
+#ifndef _WIN32
+        ssize_t written = write(STDOUT_FILENO, message, sizeof(message) - 1);
+        (void)written;
+#else
+        fwrite(message, 1, sizeof(message) - 1, stdout);
+#endif
+#else
+        capturePending = 1;
+#endif
+    }
+
+    bool writeTrace(const char* filename)
+    {
+        FILE* file = fopen(filename, "w");
+        if(!file)
+        {
+            cout << "Unable to write profiler trace: " << filename << endl;
+            return false;
+        }
+
+        // NOTE: Holding the lock for the whole write (rather than copying the registry) keeps
+        //       captures free of heap allocations; at worst a brand new thread waits a moment
+        //       before recording its first event
+        lock_guard<mutex> lock(registryMutex);
+        const vector<ThreadBuffer*>& buffers = registry;
+
+        double microsecondsPerTick = 0.001;
+#ifdef PROFILER_USE_TSC
+        int64_t elapsedTicks = now() - calibrationTicks;
+        int64_t elapsedNanoseconds = steadyNanoseconds() - calibrationNanoseconds;
+        if(elapsedTicks > 0 && elapsedNanoseconds > 0)
+        {
+            microsecondsPerTick = 0.001 * elapsedNanoseconds / elapsedTicks;
+        }
+#endif
+
+        // Chrome traces want microseconds; keep them relative to the oldest event so they stay
+        // readable
+        int64_t origin = INT64_MAX;
+        for(size_t b=0; b<buffers.size(); b++)
+        {
+            uint32_t end = buffers[b]->next.load(memory_order_acquire);
+            uint32_t start = (end > EVENTS_PER_THREAD) ? end - EVENTS_PER_THREAD : 0;
+            if(start != end && buffers[b]->events[start & (EVENTS_PER_THREAD - 1)].time < origin)
+            {
+                origin = buffers[b]->events[start & (EVENTS_PER_THREAD - 1)].time;
+            }
+        }
+
+        fprintf(file, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+        bool first = true;
+        for(size_t b=0; b<buffers.size(); b++)
+        {
+            ThreadBuffer* buffer = buffers[b];
+            if(buffer->name)
+            {
+                fprintf(file, "%s{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %d, \"args\": {\"name\": \"%s\"}}",
+                        first ? "" : ",\n", buffer->id, buffer->name);
+                first = false;
+            }
+
+            // NOTE: The owning thread keeps writing while we read, so leave a margin at the old
+            //       end of the ring that it could be overwriting right now. Events that are older
+            //       than that are stable.
+            uint32_t end = buffer->next.load(memory_order_acquire);
+            uint32_t margin = EVENTS_PER_THREAD / 16;
+            uint32_t start = (end > EVENTS_PER_THREAD - margin) ? end - (EVENTS_PER_THREAD - margin) : 0;
+
+            // The ring may start in the middle of a zone, so drop ends that have no begin
+            int depth = 0;
+            for(uint32_t i=start; i<end; i++)
+            {
+                const Event& event = buffer->events[i & (EVENTS_PER_THREAD - 1)];
+                double timestamp = (event.time - origin) * microsecondsPerTick;
+                const char* separator = first ? "" : ",\n";
+                switch(event.type)
+                {
+                case ZONE_BEGIN:
+                    depth++;
+                    fprintf(file, "%s{\"name\": \"%s\", \"ph\": \"B\", \"ts\": %.3f, \"pid\": 1, \"tid\": %d}",
+                            separator, event.name, timestamp, buffer->id);
+                    break;
+                case ZONE_END:
+                    if(depth == 0)
+                    {
+                        continue;
+                    }
+                    depth--;
+                    fprintf(file, "%s{\"name\": \"%s\", \"ph\": \"E\", \"ts\": %.3f, \"pid\": 1, \"tid\": %d}",
+                            separator, event.name, timestamp, buffer->id);
+                    break;
+                case COUNTER:
+                    fprintf(file, "%s{\"name\": \"%s\", \"ph\": \"C\", \"ts\": %.3f, \"pid\": 1, \"tid\": %d, \"args\": {\"value\": %g}}",
+                            separator, event.name, timestamp, buffer->id, event.value);
+                    break;
+                case FRAME_MARK:
+                    fprintf(file, "%s{\"name\": \"%s\", \"ph\": \"i\", \"s\": \"g\", \"ts\": %.3f, \"pid\": 1, \"tid\": %d}",
+                            separator, event.name, timestamp, buffer->id);
+                    break;
+                }
+                first = false;
+            }
+        }
+        fprintf(file, "\n]}\n");
+        fclose(file);
+        return true;
+    }
+}
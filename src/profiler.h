@@ -0,0 +1,85 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stdint.h>
+
+// A small CPU profiler for finding out where frame and load time goes. Zones, counters and frame
+// markers are recorded into a fixed-size ring buffer per thread, with no locks and no allocation
+// once a thread has recorded its first event. The ring always holds the most recent
+// EVENTS_PER_THREAD events of each thread, and requestCapture() (bound to F9 in main(), and to
+// SIGUSR1 on POSIX systems) writes them out at the next frame marker as a Chrome trace, which can
+// be opened in chrome://tracing or https://ui.perfetto.dev.
+//
+// Use the PROFILE_* macros rather than the functions directly: building with -DPROFILER_DISABLED
+// (make PROFILER=0) turns all of them into nothing.
+//
+// NOTE: Zone and counter names must be string literals (or otherwise never be freed), since only
+//       the pointer is stored.
+
+namespace profiler
+{
+    enum EventType
+    {
+        ZONE_BEGIN,
+        ZONE_END,
+        COUNTER,
+        FRAME_MARK
+    };
+
+    // Must be a power of two
+    static const uint32_t EVENTS_PER_THREAD = 1 << 16;
+
+    // Installs the SIGUSR1 handler. Call once from the main thread.
+    void init();
+
+    // Names the calling thread in captured traces
+    void setThreadName(const char* name);
+
+    void record(EventType type, const char* name, double value=0.0);
+
+    // Records a frame marker and writes out a trace if one was requested since the last frame
+    void frameMark();
+
+    // Async-signal-safe: only sets a flag that the next frameMark() picks up
+    void requestCapture();
+
+    // Writes every thread's recorded events to a Chrome trace JSON file
+    bool writeTrace(const char* filename);
+
+    class ScopedZone
+    {
+    public:
+        ScopedZone(const char* name) : name(name)
+        {
+            record(ZONE_BEGIN, name);
+        }
+        ~ScopedZone()
+        {
+            record(ZONE_END, name);
+        }
+
+    private:
+        const char* name;
+    };
+}
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#ifndef PROFILER_DISABLED
+#define PROFILE_ZONE(name) profiler::ScopedZone PROFILE_CONCAT(profileZone, __LINE__)(name)
+#define PROFILE_ZONE_BEGIN(name) profiler::record(profiler::ZONE_BEGIN, name)
+#define PROFILE_ZONE_END(name) profiler::record(profiler::ZONE_END, name)
+#define PROFILE_COUNTER(name, value) profiler::record(profiler::COUNTER, name, (double)(value))
+#define PROFILE_FRAME() profiler::frameMark()
+#define PROFILE_THREAD_NAME(name) profiler::setThreadName(name)
+#else
+#define PROFILE_ZONE(name) ((void)0)
+#define PROFILE_ZONE_BEGIN(name) ((void)0)
+#define PROFILE_ZONE_END(name) ((void)0)
+#define PROFILE_COUNTER(name, value) ((void)0)
+#define PROFILE_FRAME() ((void)0)
+#define PROFILE_THREAD_NAME(name) ((void)0)
+#endif
+
+#endif
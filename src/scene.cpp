@@ -0,0 +1,30 @@
+#include <math.h>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "scene.h"
+
+void computeBodyStates(float alpha, float beta, std::vector<BodyState>& bodies)
+{
+    bodies.resize(3);
+
+    BodyState& sun = bodies[0];
+    sun.position = glm::vec3(0.0f, 0.0f, -3.0f);
+    sun.scale = 1.0f;
+    sun.texture = SUN_TEXTURE;
+
+    BodyState& earth = bodies[1];
+    earth.position = glm::vec3(4.0f * cos(glm::radians(alpha)), 4.0f * sin(glm::radians(alpha)), -3.0f);
+    earth.scale = 0.3f;
+    earth.texture = EARTH_TEXTURE;
+
+    BodyState& moon = bodies[2];
+    moon.position = earth.position + glm::vec3(1.5f * cos(glm::radians(beta)), 1.5f * sin(glm::radians(beta)), 0.0f);
+    moon.scale = 0.1f;
+    moon.texture = MOON_TEXTURE;
+}
+
+glm::mat4 bodyModelMatrix(const BodyState& body)
+{
+    glm::mat4 modelMatrix = glm::translate(glm::mat4(1.0f), body.position);
+    return glm::scale(modelMatrix, glm::vec3(body.scale));
+}
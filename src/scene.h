@@ -0,0 +1,30 @@
+#ifndef SCENE_H
+#define SCENE_H
+
+#include <vector>
+#include <glm/glm.hpp>
+
+// Indices into the list of body textures loaded by OpenGLWindow
+enum BodyTexture
+{
+    SUN_TEXTURE,
+    EARTH_TEXTURE,
+    MOON_TEXTURE,
+    BODY_TEXTURE_COUNT
+};
+
+struct BodyState
+{
+    glm::vec3 position;
+    float scale;
+    int texture;
+};
+
+// Lays out the sun, earth and moon for the given orbit angles (in degrees), replacing the contents
+// of bodies. alpha is the earth's angle around the sun and beta the moon's angle around the earth.
+void computeBodyStates(float alpha, float beta, std::vector<BodyState>& bodies);
+
+// Model matrix for a body (a translation and a uniform scale)
+glm::mat4 bodyModelMatrix(const BodyState& body);
+
+#endif
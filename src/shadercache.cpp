@@ -0,0 +1,277 @@
+#include <iostream>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+#include "shadercache.h"
+#include "glhooks.h"
+#include "profiler.h"
+
+using namespace std;
+
+// NOTE: Bump this whenever the layout of the cache files changes
+static const uint32_t CACHE_FILE_MAGIC = 0x4E425353; // "SSBN"
+static const uint32_t CACHE_FILE_VERSION = 1;
+
+struct CacheFileHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t binaryFormat;
+    uint32_t binaryLength;
+};
+
+static bool readTextFile(const char* filename, string& text)
+{
+    FILE* file = fopen(filename, "rb");
+    if(!file)
+    {
+        return false;
+    }
+
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    text.resize(size);
+    size_t readCount = fread(&text[0], 1, size, file);
+    text.resize(readCount);
+    fclose(file);
+
+    return true;
+}
+
+// 64-bit FNV-1a, which is plenty for telling apart a handful of shader sources
+static uint64_t hashBytes(const void* data, size_t size, uint64_t hash=14695981039346656037ULL)
+{
+    const unsigned char* bytes = (const unsigned char*)data;
+    for(size_t i=0; i<size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static GLuint compileShader(const string& source, GLenum shaderType, const char* label)
+{
+    const char* text = source.c_str();
+    GLuint shader = glCreateShader(shaderType);
+    glShaderSource(shader, 1, &text, NULL);
+    glCompileShader(shader);
+
+    GLint compileStatus;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &compileStatus);
+    if(compileStatus != GL_TRUE)
+    {
+        GLsizei logLength = 0;
+        GLchar message[1024];
+        glGetShaderInfoLog(shader, 1024, &logLength, message);
+        cout << "Shader compile error in " << label << ": " << message << endl;
+    }
+
+    return shader;
+}
+
+ShaderCache::ShaderCache()
+    : binarySupported(false), hits(0), misses(0)
+{
+}
+
+void ShaderCache::init(const string& cacheDirectory)
+{
+    directory = cacheDirectory;
+
+    driverIdentity = (const char*)glGetString(GL_VENDOR);
+    driverIdentity += '\n';
+    driverIdentity += (const char*)glGetString(GL_RENDERER);
+    driverIdentity += '\n';
+    driverIdentity += (const char*)glGetString(GL_VERSION);
+
+    // NOTE: Some drivers expose the entry points but report zero binary formats, in which case
+    //       there is nothing we could ever store
+    GLint formatCount = 0;
+    if(GLEW_VERSION_4_1 || GLEW_ARB_get_program_binary)
+    {
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+    }
+    binarySupported = (formatCount > 0);
+    if(!binarySupported)
+    {
+        cout << "Shader cache: program binaries not supported by this driver, compiling from source" << endl;
+        return;
+    }
+
+#ifdef _WIN32
+    _mkdir(directory.c_str());
+#else
+    mkdir(directory.c_str(), 0755);
+#endif
+}
+
+GLuint ShaderCache::loadProgram(const char* vertShaderFilename, const char* fragShaderFilename)
+{
+    PROFILE_ZONE("loadProgram");
+    string vertSource;
+    string fragSource;
+    if(!readTextFile(vertShaderFilename, vertSource) || !readTextFile(fragShaderFilename, fragSource))
+    {
+        cout << "Unable to read shader sources: " << vertShaderFilename << ", " << fragShaderFilename << endl;
+        return 0;
+    }
+
+    string cacheFilename;
+    if(binarySupported)
+    {
+        // NOTE: The NUL separators stop "ab"+"c" and "a"+"bc" from hashing to the same key
+        uint64_t hash = hashBytes(&CACHE_FILE_VERSION, sizeof(CACHE_FILE_VERSION));
+        hash = hashBytes(vertSource.c_str(), vertSource.size()+1, hash);
+        hash = hashBytes(fragSource.c_str(), fragSource.size()+1, hash);
+        hash = hashBytes(driverIdentity.c_str(), driverIdentity.size()+1, hash);
+
+        char hashText[17];
+        snprintf(hashText, sizeof(hashText), "%016llx", (unsigned long long)hash);
+        cacheFilename = directory + "/" + hashText + ".bin";
+
+        GLuint cachedProgram = loadCachedProgram(cacheFilename);
+        if(cachedProgram)
+        {
+            hits++;
+            return cachedProgram;
+        }
+    }
+    misses++;
+
+    GLuint vertShader = compileShader(vertSource, GL_VERTEX_SHADER, vertShaderFilename);
+    GLuint fragShader = compileShader(fragSource, GL_FRAGMENT_SHADER, fragShaderFilename);
+
+    GLuint program = glCreateProgram();
+    if(binarySupported)
+    {
+        glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+    glAttachShader(program, vertShader);
+    glAttachShader(program, fragShader);
+    glLinkProgram(program);
+    glDeleteShader(vertShader);
+    glDeleteShader(fragShader);
+
+    GLint linkStatus;
+    glGetProgramiv(program, GL_LINK_STATUS, &linkStatus);
+    if(linkStatus != GL_TRUE)
+    {
+        GLsizei logLength = 0;
+        GLchar message[1024];
+        glGetProgramInfoLog(program, 1024, &logLength, message);
+        cout << "Shader load error: " << message << endl;
+        glDeleteProgram(program);
+        return 0;
+    }
+
+    if(binarySupported)
+    {
+        storeProgram(program, cacheFilename);
+    }
+
+    return program;
+}
+
+GLuint ShaderCache::loadCachedProgram(const string& cacheFilename)
+{
+    FILE* file = fopen(cacheFilename.c_str(), "rb");
+    if(!file)
+    {
+        return 0;
+    }
+
+    CacheFileHeader header;
+    vector<char> binary;
+    bool valid = (fread(&header, sizeof(header), 1, file) == 1) &&
+                 (header.magic == CACHE_FILE_MAGIC) &&
+                 (header.version == CACHE_FILE_VERSION);
+    if(valid)
+    {
+        // NOTE: The length comes from disk, so it is checked against what the file actually
+        //       holds before anything gets allocated for it
+        long start = ftell(file);
+        valid = (start >= 0) && (fseek(file, 0, SEEK_END) == 0);
+        long end = valid ? ftell(file) : -1;
+        valid = valid && (end >= start) && ((unsigned long)(end - start) == header.binaryLength) &&
+                (header.binaryLength > 0) && (fseek(file, start, SEEK_SET) == 0);
+    }
+    if(valid)
+    {
+        binary.resize(header.binaryLength);
+        valid = (fread(binary.data(), 1, binary.size(), file) == binary.size());
+    }
+    fclose(file);
+
+    if(!valid)
+    {
+        cout << "Shader cache: ignoring corrupt entry " << cacheFilename << endl;
+        return 0;
+    }
+
+    // NOTE: The driver is free to reject a binary (e.g. after an update that didn't change the
+    //       version string), in which case we just fall back to compiling from source
+    GLuint program = glCreateProgram();
+    glProgramBinary(program, header.binaryFormat, binary.data(), (GLsizei)binary.size());
+
+    GLint linkStatus;
+    glGetProgramiv(program, GL_LINK_STATUS, &linkStatus);
+    if(linkStatus != GL_TRUE)
+    {
+        cout << "Shader cache: driver rejected " << cacheFilename << ", recompiling" << endl;
+        glDeleteProgram(program);
+        return 0;
+    }
+
+    return program;
+}
+
+void ShaderCache::storeProgram(GLuint program, const string& cacheFilename)
+{
+    GLint binaryLength = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &binaryLength);
+    if(binaryLength <= 0)
+    {
+        return;
+    }
+
+    vector<char> binary(binaryLength);
+    GLenum binaryFormat = 0;
+    glGetProgramBinary(program, binaryLength, NULL, &binaryFormat, binary.data());
+
+    FILE* file = fopen(cacheFilename.c_str(), "wb");
+    if(!file)
+    {
+        cout << "Shader cache: unable to write " << cacheFilename << endl;
+        return;
+    }
+
+    CacheFileHeader header;
+    header.magic = CACHE_FILE_MAGIC;
+    header.version = CACHE_FILE_VERSION;
+    header.binaryFormat = binaryFormat;
+    header.binaryLength = binaryLength;
+    fwrite(&header, sizeof(header), 1, file);
+    fwrite(binary.data(), 1, binary.size(), file);
+    fclose(file);
+}
+
+int ShaderCache::hitCount()
+{
+    return hits;
+}
+
+int ShaderCache::missCount()
+{
+    return misses;
+}
@@ -0,0 +1,35 @@
+#ifndef SHADER_CACHE_H
+#define SHADER_CACHE_H
+
+#include <string>
+#include <GL/glew.h>
+
+// Loads shader programs, keeping the linked program binaries on disk so that later runs can skip
+// compiling and linking from source. Entries are keyed by a hash of the shader sources together
+// with the GL vendor/renderer/version strings, so a driver update simply results in a cache miss.
+class ShaderCache
+{
+public:
+    ShaderCache();
+
+    // Must be called with a current GL context, before the first loadProgram() call
+    void init(const std::string& cacheDirectory);
+
+    // Returns the linked program, or 0 if the shaders could not be loaded
+    GLuint loadProgram(const char* vertShaderFilename, const char* fragShaderFilename);
+
+    int hitCount();
+    int missCount();
+
+private:
+    GLuint loadCachedProgram(const std::string& cacheFilename);
+    void storeProgram(GLuint program, const std::string& cacheFilename);
+
+    std::string directory;
+    std::string driverIdentity;
+    bool binarySupported;
+    int hits;
+    int misses;
+};
+
+#endif
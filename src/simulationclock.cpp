@@ -0,0 +1,106 @@
+#include <math.h>
+#include "SDL.h"
+
+#include "simulationclock.h"
+
+const double SimulationClock::STEP_SECONDS = 1.0 / 60.0;
+const double SimulationClock::MAX_FRAME_SECONDS = 0.25;
+
+static double wrapDegrees(double angle)
+{
+    angle = fmod(angle, 360.0);
+    return (angle < 0.0) ? angle + 360.0 : angle;
+}
+
+SimulationClock::SimulationClock()
+    : lastCounter(SDL_GetPerformanceCounter()), accumulator(0.0), stepCount(0), isPaused(false),
+      alphaIncrement(0.0), betaIncrement(0.0)
+{
+    current.alpha = current.beta = 0.0;
+    previous = current;
+    lastStep.alpha = lastStep.beta = 0.0;
+}
+
+void SimulationClock::setSpeed(double alphaIncrement, double betaIncrement)
+{
+    this->alphaIncrement = alphaIncrement;
+    this->betaIncrement = betaIncrement;
+}
+
+void SimulationClock::setPaused(bool paused)
+{
+    isPaused = paused;
+}
+
+bool SimulationClock::paused() const
+{
+    return isPaused;
+}
+
+int SimulationClock::advance()
+{
+    uint64_t now = SDL_GetPerformanceCounter();
+    double elapsed = (double)(now - lastCounter) / SDL_GetPerformanceFrequency();
+    lastCounter = now;
+    return advanceBy(elapsed);
+}
+
+int SimulationClock::advanceBy(double seconds)
+{
+    // NOTE: Pausing freezes what is on screen, which is part way between the last two steps (as
+    //       of now, so including the time since the last call), so that state becomes the
+    //       current one and the leftover fraction of a step is dropped
+    if(isPaused)
+    {
+        current = interpolated(seconds);
+        previous = current;
+        lastStep.alpha = lastStep.beta = 0.0;
+        accumulator = 0.0;
+        return 0;
+    }
+
+    accumulator += (seconds < MAX_FRAME_SECONDS) ? seconds : MAX_FRAME_SECONDS;
+    int steps = 0;
+    while(accumulator >= STEP_SECONDS)
+    {
+        step();
+        accumulator -= STEP_SECONDS;
+        steps++;
+    }
+    return steps;
+}
+
+void SimulationClock::step()
+{
+    previous = current;
+    lastStep.alpha = alphaIncrement;
+    lastStep.beta = betaIncrement;
+    current.alpha = wrapDegrees(current.alpha + alphaIncrement);
+    current.beta = wrapDegrees(current.beta + betaIncrement);
+    stepCount++;
+}
+
+OrbitState SimulationClock::interpolated(double extraSeconds) const
+{
+    double t = (accumulator + extraSeconds) / STEP_SECONDS;
+    t = (t < 1.0) ? t : 1.0;
+    OrbitState state;
+    state.alpha = wrapDegrees(previous.alpha + t * lastStep.alpha);
+    state.beta = wrapDegrees(previous.beta + t * lastStep.beta);
+    return state;
+}
+
+double SimulationClock::timeToNextStep() const
+{
+    return STEP_SECONDS - accumulator;
+}
+
+double SimulationClock::time() const
+{
+    return stepCount * STEP_SECONDS;
+}
+
+uint64_t SimulationClock::steps() const
+{
+    return stepCount;
+}
@@ -0,0 +1,78 @@
+#ifndef SIMULATION_CLOCK_H
+#define SIMULATION_CLOCK_H
+
+#include <stdint.h>
+
+// Orbit angles in degrees: alpha is the earth's angle around the sun and beta the moon's angle
+// around the earth (see computeBodyStates())
+struct OrbitState
+{
+    double alpha;
+    double beta;
+};
+
+// Advances the orbits in fixed steps of STEP_SECONDS, driven by the high-resolution timer rather
+// than by the frame rate. Wall-clock time accumulates between frames and is spent in whole steps,
+// so the motion is the same at 30, 60 or 144 frames per second and a slow frame makes the next
+// one take several steps instead of slowing the simulation down. Rendering uses interpolated(),
+// which blends the last two steps by the leftover fraction of a step so motion stays smooth when
+// frames and steps don't line up.
+//
+// The angles are doubles wrapped to [0, 360), so they keep their precision however long the
+// simulation runs; time() is the total simulated time since the start.
+class SimulationClock
+{
+public:
+    static const double STEP_SECONDS;
+
+    // A stall longer than this (a debugger, a dragged window) is dropped rather than caught up
+    // with, so the simulation never spends frames stepping through hundreds of missed steps
+    static const double MAX_FRAME_SECONDS;
+
+    SimulationClock();
+
+    // Degrees the earth and moon move per step
+    void setSpeed(double alphaIncrement, double betaIncrement);
+
+    // A paused clock lets wall-clock time pass without stepping
+    void setPaused(bool paused);
+    bool paused() const;
+
+    // Runs every whole step that fits into the time since the last call (or since construction).
+    // Returns the number of steps taken.
+    int advance();
+
+    // Same, for a given amount of time instead of the timer, e.g. exactly one step per frame when
+    // the frames are written out and have to come out the same on every run
+    int advanceBy(double seconds);
+
+    // The state to render: the last two steps blended by how far into the next step the
+    // accumulated time is. extraSeconds is time that has passed since the last advance(), for
+    // when the clock is read some time after it was advanced (at most up to the latest step).
+    OrbitState interpolated(double extraSeconds=0.0) const;
+
+    // How long until the next step is due
+    double timeToNextStep() const;
+
+    double time() const;
+    uint64_t steps() const;
+
+private:
+    void step();
+
+    uint64_t lastCounter;
+    double accumulator;
+    uint64_t stepCount;
+    bool isPaused;
+
+    double alphaIncrement;
+    double betaIncrement;
+
+    // NOTE: previous is the state before the last step and lastStep what that step added, so
+    //       blending never has to guess which way round the circle a wrapped angle went
+    OrbitState current;
+    OrbitState previous;
+    OrbitState lastStep;
+};
+
+#endif
@@ -0,0 +1,163 @@
+#include <chrono>
+#include <mutex>
+#include "SDL.h"
+
+#include "simulationthread.h"
+#include "profiler.h"
+
+using namespace std;
+
+SimulationCommand SimulationCommand::setSpeed(double alphaIncrement, double betaIncrement)
+{
+    SimulationCommand command;
+    command.type = SET_SPEED;
+    command.alphaIncrement = alphaIncrement;
+    command.betaIncrement = betaIncrement;
+    command.paused = false;
+    return command;
+}
+
+SimulationCommand SimulationCommand::setPaused(bool paused)
+{
+    SimulationCommand command;
+    command.type = SET_PAUSED;
+    command.alphaIncrement = command.betaIncrement = 0.0;
+    command.paused = paused;
+    return command;
+}
+
+SimulationSnapshot::SimulationSnapshot()
+    : publishedAt(0), followsTimer(false)
+{
+}
+
+OrbitState SimulationSnapshot::interpolated() const
+{
+    if(!followsTimer)
+    {
+        return clock.interpolated();
+    }
+    double sincePublished = (double)(SDL_GetPerformanceCounter() - publishedAt) / SDL_GetPerformanceFrequency();
+    return clock.interpolated(sincePublished);
+}
+
+SimulationThread::SimulationThread()
+    : stopRequested(false), commandsPosted(false)
+{
+}
+
+SimulationThread::~SimulationThread()
+{
+    stop();
+}
+
+void SimulationThread::start()
+{
+    stopRequested.store(false, memory_order_relaxed);
+    thread = std::thread(&SimulationThread::run, this);
+}
+
+void SimulationThread::stop()
+{
+    if(thread.joinable())
+    {
+        {
+            lock_guard<mutex> lock(wakeMutex);
+            stopRequested.store(true, memory_order_relaxed);
+        }
+        wakeCondition.notify_one();
+        thread.join();
+    }
+}
+
+bool SimulationThread::post(const SimulationCommand& command)
+{
+    if(!commands.push(command))
+    {
+        return false;
+    }
+    {
+        lock_guard<mutex> lock(wakeMutex);
+        commandsPosted = true;
+    }
+    wakeCondition.notify_one();
+    return true;
+}
+
+void SimulationThread::update(double seconds)
+{
+    applyCommands();
+    clock.advanceBy(seconds);
+    publish(false);
+}
+
+const SimulationSnapshot& SimulationThread::latest()
+{
+    return snapshots.read();
+}
+
+void SimulationThread::run()
+{
+    PROFILE_THREAD_NAME("simulation");
+
+    while(!stopRequested.load(memory_order_relaxed))
+    {
+        applyCommands();
+        {
+            PROFILE_ZONE("simulation update");
+            clock.advance();
+        }
+        publish(true);
+
+        // NOTE: Sleeping until the next step is due keeps the thread idle almost all the time.
+        //       Waking up late only delays the step, not the motion: the snapshot carries the
+        //       leftover time and the renderer interpolates from when it was published. A paused
+        //       clock has nothing to step, so the thread sleeps until a command arrives.
+        unique_lock<mutex> lock(wakeMutex);
+        bool paused = clock.paused();
+        if(paused)
+        {
+            wakeCondition.wait(lock, [this]() { return commandsPosted || stopRequested.load(memory_order_relaxed); });
+        }
+        else
+        {
+            wakeCondition.wait_for(lock, chrono::duration<double>(clock.timeToNextStep()),
+                                   [this]() { return commandsPosted || stopRequested.load(memory_order_relaxed); });
+        }
+        commandsPosted = false;
+        lock.unlock();
+
+        // NOTE: The time spent paused must not count once the clock runs again, so it is let
+        //       pass (as the still paused clock does) before the commands get applied
+        if(paused)
+        {
+            clock.advance();
+        }
+    }
+}
+
+void SimulationThread::applyCommands()
+{
+    SimulationCommand command;
+    while(commands.pop(command))
+    {
+        switch(command.type)
+        {
+            case SimulationCommand::SET_SPEED:
+                clock.setSpeed(command.alphaIncrement, command.betaIncrement);
+                break;
+            case SimulationCommand::SET_PAUSED:
+                clock.setPaused(command.paused);
+                break;
+        }
+    }
+}
+
+void SimulationThread::publish(bool followsTimer)
+{
+    SimulationSnapshot& snapshot = snapshots.writeSlot();
+    snapshot.clock = clock;
+    snapshot.publishedAt = SDL_GetPerformanceCounter();
+    snapshot.followsTimer = followsTimer;
+    snapshots.publish();
+}
@@ -0,0 +1,95 @@
+#ifndef SIMULATION_THREAD_H
+#define SIMULATION_THREAD_H
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <stdint.h>
+#include <thread>
+
+#include "simulationclock.h"
+#include "spscqueue.h"
+#include "triplebuffer.h"
+
+// A change to the simulation, sent from the main thread (which handles the input)
+struct SimulationCommand
+{
+    enum Type
+    {
+        SET_SPEED,
+        SET_PAUSED
+    };
+
+    static SimulationCommand setSpeed(double alphaIncrement, double betaIncrement);
+    static SimulationCommand setPaused(bool paused);
+
+    Type type;
+    double alphaIncrement;
+    double betaIncrement;
+    bool paused;
+};
+
+// What the simulation publishes after every update: a copy of its clock, and when it was taken
+struct SimulationSnapshot
+{
+    SimulationSnapshot();
+
+    // The state to render now. When the snapshot follows the timer, the clock's interpolation is
+    // carried on by the time since it was published (up to the latest step, never beyond it).
+    OrbitState interpolated() const;
+
+    SimulationClock clock;
+    uint64_t publishedAt;
+    bool followsTimer;
+};
+
+// Runs the SimulationClock on its own thread, so that a slow frame never holds up the orbits and
+// a slow simulation step never holds up a frame. The main thread sends commands through a
+// lock-free queue and picks up the latest snapshot from a lock-free triple buffer; neither
+// thread ever waits for the other. While the clock is paused the thread sleeps until the next
+// command (post() wakes it up), so a paused simulation costs nothing.
+//
+// Without start() nothing runs in the background and the owner calls update() itself instead,
+// which runs exactly the same code on the calling thread (for runs that have to step in lockstep
+// with the frames).
+class SimulationThread
+{
+public:
+    static const size_t COMMAND_CAPACITY = 64;
+
+    SimulationThread();
+    ~SimulationThread();
+
+    void start();
+    void stop();
+
+    // Queues a command for the next update. Fails (and the command should be sent again later)
+    // when the queue is full.
+    bool post(const SimulationCommand& command);
+
+    // Applies the queued commands, advances the clock by the given time and publishes a snapshot
+    // that doesn't follow the timer. Only for when start() wasn't called.
+    void update(double seconds);
+
+    // The most recently published snapshot; stays valid until the next call
+    const SimulationSnapshot& latest();
+
+private:
+    void run();
+    void applyCommands();
+    void publish(bool followsTimer);
+
+    SimulationClock clock;
+    SpscQueue<SimulationCommand, COMMAND_CAPACITY> commands;
+    TripleBuffer<SimulationSnapshot> snapshots;
+
+    std::thread thread;
+    std::atomic<bool> stopRequested;
+
+    // NOTE: Only for waking the thread up early; the commands themselves go through the queue
+    std::mutex wakeMutex;
+    std::condition_variable wakeCondition;
+    bool commandsPosted;
+};
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <atomic>
+#include <stddef.h>
+
+// A fixed-size lock-free queue for exactly one producer thread and one consumer thread. push()
+// fails when the queue is full and pop() when it is empty; neither ever blocks. Capacity must be
+// a power of two.
+template<typename T, size_t Capacity>
+class SpscQueue
+{
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    SpscQueue() : head(0), tail(0) {}
+
+    // Producer side
+    bool push(const T& value)
+    {
+        size_t position = tail.load(std::memory_order_relaxed);
+        if(position - head.load(std::memory_order_acquire) == Capacity)
+        {
+            return false;
+        }
+        items[position & (Capacity - 1)] = value;
+        tail.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side
+    bool pop(T& value)
+    {
+        size_t position = head.load(std::memory_order_relaxed);
+        if(position == tail.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+        value = items[position & (Capacity - 1)];
+        head.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    T items[Capacity];
+
+    // NOTE: The counters only ever grow and are masked into the ring, so full and empty can be
+    //       told apart without wasting a slot
+    alignas(64) std::atomic<size_t> head;
+    alignas(64) std::atomic<size_t> tail;
+};
+
+#endif
@@ -0,0 +1,512 @@
+#include <chrono>
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "jobsystem.h"
+#include "stb_image.h"
+#include "texturecache.h"
+
+using namespace std;
+
+// NOTE: Bump the version whenever the container layout or the cooking process changes, so that
+//       stale containers are re-cooked rather than misread
+static const uint32_t CONTAINER_MAGIC = 0x31435854; // "TXC1"
+static const uint32_t CONTAINER_VERSION = 2;
+
+// Bigger than any texture GL will take, but small enough that level sizes can't overflow
+static const uint32_t MAX_DIMENSION = 65536;
+
+// Container layout: header, then one LevelEntry per mip level, then the level data. Every level
+// starts on a 16 byte boundary so it can be handed to GL straight out of the mapping.
+struct ContainerHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t sourceHash;
+    uint32_t width;
+    uint32_t height;
+    uint32_t levelCount;
+    uint32_t format;
+};
+
+struct LevelEntry
+{
+    uint64_t offset;
+    uint64_t size;
+    uint32_t width;
+    uint32_t height;
+};
+
+// Rows of a filtered level per job; filtering is cheap per pixel, so jobs need a fair number of
+// rows to outweigh their overhead
+static const size_t FILTER_ROWS_PER_JOB = 32;
+
+static size_t alignUp(size_t value, size_t alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+// Bytes a level of the given size takes up in the given format
+static size_t levelBytes(TextureFormat format, int width, int height)
+{
+    if(format == TEXTURE_RGBA8)
+    {
+        return (size_t)width * height * 4;
+    }
+    return bcEncodedSize((format == TEXTURE_BC1) ? BC1 : BC3, width, height);
+}
+
+static bool readWholeFile(const string& filename, vector<unsigned char>& bytes)
+{
+    FILE* file = fopen(filename.c_str(), "rb");
+    if(!file)
+    {
+        return false;
+    }
+
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    bytes.resize(size);
+    size_t readCount = fread(bytes.data(), 1, bytes.size(), file);
+    fclose(file);
+
+    return (readCount == bytes.size());
+}
+
+static uint64_t hashBytes(const unsigned char* bytes, size_t size)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    for(size_t i=0; i<size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+// Produces rows [firstRow, lastRow) of the next mip level with a 2x2 box filter (the same filter
+// glGenerateMipmap uses on common drivers). Odd dimensions clamp the last row/column.
+static void downsampleRows(const unsigned char* src, int srcWidth, int srcHeight,
+                           unsigned char* dst, int dstWidth, int firstRow, int lastRow)
+{
+    for(int y=firstRow; y<lastRow; y++)
+    {
+        int y0 = 2*y;
+        int y1 = (y0+1 < srcHeight) ? y0+1 : y0;
+        for(int x=0; x<dstWidth; x++)
+        {
+            int x0 = 2*x;
+            int x1 = (x0+1 < srcWidth) ? x0+1 : x0;
+            const unsigned char* p00 = &src[4*(y0*srcWidth + x0)];
+            const unsigned char* p01 = &src[4*(y0*srcWidth + x1)];
+            const unsigned char* p10 = &src[4*(y1*srcWidth + x0)];
+            const unsigned char* p11 = &src[4*(y1*srcWidth + x1)];
+            for(int c=0; c<4; c++)
+            {
+                dst[4*(y*dstWidth + x) + c] = (unsigned char)((p00[c] + p01[c] + p10[c] + p11[c] + 2) / 4);
+            }
+        }
+    }
+}
+
+static void downsampleRGBA(const unsigned char* src, int srcWidth, int srcHeight,
+                           unsigned char* dst, int dstWidth, int dstHeight)
+{
+    jobsystem::parallelFor(dstHeight, FILTER_ROWS_PER_JOB, [&](size_t firstRow, size_t lastRow)
+    {
+        downsampleRows(src, srcWidth, srcHeight, dst, dstWidth, (int)firstRow, (int)lastRow);
+    });
+}
+
+// Bilinear resample with pixel centers aligned, used to bring an image to a texture array's layer
+// size. Meant for modest scale factors; bigger ones are expected to keep their own texture.
+static void resampleRows(const unsigned char* src, int srcWidth, int srcHeight,
+                         unsigned char* dst, int dstWidth, int dstHeight, int firstRow, int lastRow)
+{
+    float scaleX = (float)srcWidth / dstWidth;
+    float scaleY = (float)srcHeight / dstHeight;
+    for(int y=firstRow; y<lastRow; y++)
+    {
+        float sourceY = (y + 0.5f)*scaleY - 0.5f;
+        sourceY = (sourceY < 0.0f) ? 0.0f : sourceY;
+        int y0 = (int)sourceY;
+        int y1 = (y0+1 < srcHeight) ? y0+1 : y0;
+        float fy = sourceY - y0;
+        for(int x=0; x<dstWidth; x++)
+        {
+            float sourceX = (x + 0.5f)*scaleX - 0.5f;
+            sourceX = (sourceX < 0.0f) ? 0.0f : sourceX;
+            int x0 = (int)sourceX;
+            int x1 = (x0+1 < srcWidth) ? x0+1 : x0;
+            float fx = sourceX - x0;
+            const unsigned char* p00 = &src[4*(y0*srcWidth + x0)];
+            const unsigned char* p01 = &src[4*(y0*srcWidth + x1)];
+            const unsigned char* p10 = &src[4*(y1*srcWidth + x0)];
+            const unsigned char* p11 = &src[4*(y1*srcWidth + x1)];
+            for(int c=0; c<4; c++)
+            {
+                float top = p00[c] + (p01[c] - p00[c])*fx;
+                float bottom = p10[c] + (p11[c] - p10[c])*fx;
+                dst[4*(y*dstWidth + x) + c] = (unsigned char)(top + (bottom - top)*fy + 0.5f);
+            }
+        }
+    }
+}
+
+static void resampleRGBA(const unsigned char* src, int srcWidth, int srcHeight,
+                         unsigned char* dst, int dstWidth, int dstHeight)
+{
+    jobsystem::parallelFor(dstHeight, FILTER_ROWS_PER_JOB, [&](size_t firstRow, size_t lastRow)
+    {
+        resampleRows(src, srcWidth, srcHeight, dst, dstWidth, dstHeight, (int)firstRow, (int)lastRow);
+    });
+}
+
+CookedTexture::CookedTexture()
+    : numLevels(0), textureFormat(TEXTURE_RGBA8), cacheHit(false), encodeTime(0.0),
+      mapping(NULL), mappingSize(0)
+{
+}
+
+CookedTexture::~CookedTexture()
+{
+    release();
+}
+
+void CookedTexture::release()
+{
+#ifndef _WIN32
+    if(mapping)
+    {
+        munmap(mapping, mappingSize);
+    }
+#endif
+    mapping = NULL;
+    mappingSize = 0;
+    vector<unsigned char>().swap(ownedData);
+    numLevels = 0;
+}
+
+bool CookedTexture::load(const string& sourceFilename, const string& cacheDirectory,
+                         int targetWidth, int targetHeight, TextureFormat format)
+{
+    release();
+    cacheHit = false;
+    encodeTime = 0.0;
+
+    vector<unsigned char> source;
+    if(!readWholeFile(sourceFilename, source))
+    {
+        cout << "Unable to open texture: " << sourceFilename << endl;
+        return false;
+    }
+    uint64_t sourceHash = hashBytes(source.data(), source.size());
+
+    string baseName = sourceFilename;
+    size_t slash = baseName.find_last_of("/\\");
+    if(slash != string::npos)
+    {
+        baseName = baseName.substr(slash+1);
+    }
+    if(targetWidth > 0 && targetHeight > 0)
+    {
+        char sizeText[32];
+        snprintf(sizeText, sizeof(sizeText), ".%dx%d", targetWidth, targetHeight);
+        baseName += sizeText;
+    }
+    if(format == TEXTURE_BC1)
+    {
+        baseName += ".bc1";
+    }
+    else if(format == TEXTURE_BC3)
+    {
+        baseName += ".bc3";
+    }
+    string containerFilename = cacheDirectory + "/" + baseName + ".tex";
+
+    if(mapContainer(containerFilename, sourceHash, targetWidth, targetHeight, format))
+    {
+        cacheHit = true;
+        return true;
+    }
+
+#ifdef _WIN32
+    _mkdir(cacheDirectory.c_str());
+#else
+    mkdir(cacheDirectory.c_str(), 0755);
+#endif
+    return cook(source, sourceHash, targetWidth, targetHeight, format, containerFilename);
+}
+
+bool CookedTexture::mapContainer(const string& filename, uint64_t sourceHash,
+                                 int targetWidth, int targetHeight, TextureFormat format)
+{
+    unsigned char* bytes = NULL;
+    size_t size = 0;
+
+#ifdef _WIN32
+    if(!readWholeFile(filename, ownedData))
+    {
+        return false;
+    }
+    bytes = ownedData.data();
+    size = ownedData.size();
+#else
+    int fd = open(filename.c_str(), O_RDONLY);
+    if(fd < 0)
+    {
+        return false;
+    }
+    struct stat fileInfo;
+    if(fstat(fd, &fileInfo) != 0 || fileInfo.st_size < (off_t)sizeof(ContainerHeader))
+    {
+        close(fd);
+        return false;
+    }
+    size = fileInfo.st_size;
+    void* mapped = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(mapped == MAP_FAILED)
+    {
+        return false;
+    }
+    mapping = mapped;
+    mappingSize = size;
+    bytes = (unsigned char*)mapped;
+#endif
+
+    const ContainerHeader* header = (const ContainerHeader*)bytes;
+    bool valid = (size >= sizeof(ContainerHeader)) &&
+                 (header->magic == CONTAINER_MAGIC) &&
+                 (header->version == CONTAINER_VERSION) &&
+                 (header->sourceHash == sourceHash) &&
+                 (header->format == (uint32_t)format) &&
+                 (targetWidth <= 0 || (int)header->width == targetWidth) &&
+                 (targetHeight <= 0 || (int)header->height == targetHeight) &&
+                 (header->width > 0) && (header->width <= MAX_DIMENSION) &&
+                 (header->height > 0) && (header->height <= MAX_DIMENSION) &&
+                 (header->levelCount > 0) && (header->levelCount <= MAX_LEVELS) &&
+                 (size >= sizeof(ContainerHeader) + header->levelCount*sizeof(LevelEntry));
+
+    if(valid)
+    {
+        // NOTE: The levels get uploaded straight from the mapping with the sizes they claim, so a
+        //       damaged entry that still points inside the file must not get through either:
+        //       every level has to be exactly half the one above it, and exactly as big as its
+        //       dimensions need in the stored format
+        const LevelEntry* entries = (const LevelEntry*)(bytes + sizeof(ContainerHeader));
+        uint32_t levelWidth = header->width;
+        uint32_t levelHeight = header->height;
+        for(uint32_t level=0; level<header->levelCount; level++)
+        {
+            if(entries[level].width != levelWidth || entries[level].height != levelHeight ||
+               entries[level].size != levelBytes(format, levelWidth, levelHeight) ||
+               entries[level].offset > size || entries[level].size > size - entries[level].offset)
+            {
+                valid = false;
+                break;
+            }
+            levelWidth = (levelWidth > 1) ? levelWidth/2 : 1;
+            levelHeight = (levelHeight > 1) ? levelHeight/2 : 1;
+            levels[level].width = entries[level].width;
+            levels[level].height = entries[level].height;
+            levels[level].data = bytes + entries[level].offset;
+            levels[level].size = entries[level].size;
+        }
+        numLevels = header->levelCount;
+        textureFormat = format;
+    }
+
+    if(!valid)
+    {
+        release();
+    }
+    return valid;
+}
+
+bool CookedTexture::cook(const vector<unsigned char>& source, uint64_t sourceHash,
+                         int targetWidth, int targetHeight, TextureFormat format,
+                         const string& containerFilename)
+{
+    int width, height, channelCount;
+    // NOTE: The per-thread flag, since textures may be cooked on several threads at once
+    stbi_set_flip_vertically_on_load_thread(true);
+    unsigned char* pixels = stbi_load_from_memory(source.data(), (int)source.size(),
+                                                  &width, &height, &channelCount, 4);
+    if(!pixels)
+    {
+        cout << "Failed to decode texture: " << containerFilename << endl;
+        return false;
+    }
+
+    if(targetWidth > 0 && targetHeight > 0 && (targetWidth != width || targetHeight != height))
+    {
+        unsigned char* resampled = (unsigned char*)malloc((size_t)targetWidth * targetHeight * 4);
+        resampleRGBA(pixels, width, height, resampled, targetWidth, targetHeight);
+        stbi_image_free(pixels);
+        pixels = resampled;
+        width = targetWidth;
+        height = targetHeight;
+    }
+
+    // Build the uncompressed mip chain first, since every level is filtered from the one above it
+    vector<vector<unsigned char> > mips;
+    vector<int> mipWidths;
+    vector<int> mipHeights;
+    mips.push_back(vector<unsigned char>(pixels, pixels + (size_t)width*height*4));
+    mipWidths.push_back(width);
+    mipHeights.push_back(height);
+    stbi_image_free(pixels);
+    while(mips.size() < (size_t)MAX_LEVELS && (mipWidths.back() > 1 || mipHeights.back() > 1))
+    {
+        int levelWidth = (mipWidths.back() > 1) ? mipWidths.back()/2 : 1;
+        int levelHeight = (mipHeights.back() > 1) ? mipHeights.back()/2 : 1;
+        mips.push_back(vector<unsigned char>((size_t)levelWidth*levelHeight*4));
+        downsampleRGBA(mips[mips.size()-2].data(), mipWidths.back(), mipHeights.back(),
+                       mips.back().data(), levelWidth, levelHeight);
+        mipWidths.push_back(levelWidth);
+        mipHeights.push_back(levelHeight);
+    }
+    int levelCount = mips.size();
+
+    // Work out where every level lives in the container
+    LevelEntry entries[MAX_LEVELS];
+    size_t offset = alignUp(sizeof(ContainerHeader) + MAX_LEVELS*sizeof(LevelEntry), 16);
+    for(int level=0; level<levelCount; level++)
+    {
+        entries[level].offset = offset;
+        entries[level].width = mipWidths[level];
+        entries[level].height = mipHeights[level];
+        entries[level].size = levelBytes(format, mipWidths[level], mipHeights[level]);
+        offset = alignUp(offset + entries[level].size, 16);
+    }
+
+    ownedData.assign(offset, 0);
+    unsigned char* bytes = ownedData.data();
+
+    ContainerHeader header = {};
+    header.magic = CONTAINER_MAGIC;
+    header.version = CONTAINER_VERSION;
+    header.sourceHash = sourceHash;
+    header.width = width;
+    header.height = height;
+    header.levelCount = levelCount;
+    header.format = format;
+    memcpy(bytes, &header, sizeof(header));
+    memcpy(bytes + sizeof(header), entries, levelCount*sizeof(LevelEntry));
+
+    chrono::steady_clock::time_point encodeStart = chrono::steady_clock::now();
+    for(int level=0; level<levelCount; level++)
+    {
+        if(format == TEXTURE_RGBA8)
+        {
+            memcpy(bytes + entries[level].offset, mips[level].data(), entries[level].size);
+        }
+        else
+        {
+            BCFormat bcFormat = (format == TEXTURE_BC1) ? BC1 : BC3;
+            bcEncodeImage(bcFormat, mips[level].data(), mipWidths[level], mipHeights[level],
+                          bytes + entries[level].offset);
+        }
+    }
+    if(format != TEXTURE_RGBA8)
+    {
+        encodeTime = chrono::duration<double, milli>(chrono::steady_clock::now() - encodeStart).count();
+    }
+
+    numLevels = levelCount;
+    textureFormat = format;
+    for(int level=0; level<levelCount; level++)
+    {
+        levels[level].width = entries[level].width;
+        levels[level].height = entries[level].height;
+        levels[level].data = bytes + entries[level].offset;
+        levels[level].size = entries[level].size;
+    }
+
+    // NOTE: Write to a temporary file and rename it into place, so that a crash part way through
+    //       never leaves a truncated container behind for the next run to map
+    string tempFilename = containerFilename + ".tmp";
+    FILE* file = fopen(tempFilename.c_str(), "wb");
+    if(!file)
+    {
+        cout << "Texture cache: unable to write " << containerFilename << endl;
+        return true;
+    }
+    bool written = (fwrite(bytes, 1, ownedData.size(), file) == ownedData.size());
+    written = (fclose(file) == 0) && written;
+    if(!written)
+    {
+        remove(tempFilename.c_str());
+        return true;
+    }
+#ifdef _WIN32
+    remove(containerFilename.c_str());
+#endif
+    rename(tempFilename.c_str(), containerFilename.c_str());
+
+    return true;
+}
+
+bool CookedTexture::fromCache()
+{
+    return cacheHit;
+}
+
+double CookedTexture::encodeMilliseconds()
+{
+    return encodeTime;
+}
+
+TextureFormat CookedTexture::format()
+{
+    return textureFormat;
+}
+
+int CookedTexture::levelCount()
+{
+    return numLevels;
+}
+
+int CookedTexture::width(int level)
+{
+    return levels[level].width;
+}
+
+int CookedTexture::height(int level)
+{
+    return levels[level].height;
+}
+
+const unsigned char* CookedTexture::levelData(int level)
+{
+    return levels[level].data;
+}
+
+size_t CookedTexture::levelSize(int level)
+{
+    return levels[level].size;
+}
+
+size_t CookedTexture::totalSize()
+{
+    size_t size = 0;
+    for(int level=0; level<numLevels; level++)
+    {
+        size += levels[level].size;
+    }
+    return size;
+}
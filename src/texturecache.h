@@ -0,0 +1,86 @@
+#ifndef TEXTURE_CACHE_H
+#define TEXTURE_CACHE_H
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "bcencoder.h"
+
+enum TextureFormat
+{
+    TEXTURE_RGBA8,
+    TEXTURE_BC1,
+    TEXTURE_BC3
+};
+
+// A texture together with its full mip chain, laid out exactly as glTexImage2D expects it (rows
+// bottom-up, tightly packed RGBA8). The first time a source image is loaded it is decoded,
+// flipped and mipmapped, then "cooked" into a container file in the cache directory. Later loads
+// memory-map that container directly, so there is no PNG decode and no runtime mip generation.
+// The container records a hash of the source file, so editing the PNG invalidates it.
+//
+// A target size may be given to resample the image (bilinearly) before building the mip chain,
+// e.g. so that it fits a layer of a texture array. Each target size is cooked into its own
+// container.
+//
+// The mip chain can also be block compressed (BC1/BC3) at cook time, so the (comparatively slow)
+// encode only ever happens once per source image and target size.
+class CookedTexture
+{
+public:
+    static const int MAX_LEVELS = 16;
+
+    CookedTexture();
+    ~CookedTexture();
+
+    bool load(const std::string& sourceFilename, const std::string& cacheDirectory,
+              int targetWidth=0, int targetHeight=0, TextureFormat format=TEXTURE_RGBA8);
+    void release();
+
+    // True if the last load() was served from an existing container
+    bool fromCache();
+
+    // Time spent block compressing during the last load() (0 unless it was cooked compressed)
+    double encodeMilliseconds();
+
+    TextureFormat format();
+    int levelCount();
+    int width(int level=0);
+    int height(int level=0);
+    const unsigned char* levelData(int level);
+    size_t levelSize(int level);
+    size_t totalSize();
+
+private:
+    // Not copyable, since it may own a file mapping
+    CookedTexture(const CookedTexture&);
+    CookedTexture& operator=(const CookedTexture&);
+
+    bool mapContainer(const std::string& filename, uint64_t sourceHash, int targetWidth, int targetHeight,
+                      TextureFormat format);
+    bool cook(const std::vector<unsigned char>& source, uint64_t sourceHash,
+              int targetWidth, int targetHeight, TextureFormat format,
+              const std::string& containerFilename);
+
+    struct Level
+    {
+        int width;
+        int height;
+        const unsigned char* data;
+        size_t size;
+    };
+
+    Level levels[MAX_LEVELS];
+    int numLevels;
+    TextureFormat textureFormat;
+    bool cacheHit;
+    double encodeTime;
+
+    // Exactly one of these backs the level data
+    void* mapping;
+    size_t mappingSize;
+    std::vector<unsigned char> ownedData;
+};
+
+#endif
@@ -0,0 +1,397 @@
+#include <iostream>
+#include <string.h>
+#include <thread>
+#include "SDL.h"
+#include "stb_image.h"
+
+#include "texturestreamer.h"
+#include "gldebug.h"
+#include "glhooks.h"
+#include "jobsystem.h"
+#include "profiler.h"
+
+using namespace std;
+
+// "textures/earth_diffuse.png" -> "earth_diffuse"
+static string textureLabel(const string& filename)
+{
+    size_t start = filename.find_last_of("/\\");
+    start = (start == string::npos) ? 0 : start + 1;
+    size_t end = filename.find_last_of('.');
+    end = (end == string::npos || end < start) ? filename.size() : end;
+    return filename.substr(start, end - start);
+}
+
+TextureStreamer::TextureStreamer()
+    : bytesPerFrame(0), placeholder(0), format(TEXTURE_RGBA8), compressedFormat(0), layerArray(0), layerWidth(0), layerHeight(0),
+      layerCapacity(0), layersUsed(0), pboSize(0), nextPbo(0), loadsInFlight(0), stopping(false),
+      pendingCount(0), cachedCount(0), gpuBytes(0), rgbaBytes(0), encodeMilliseconds(0.0),
+      encodedPixels(0.0), startTime(0)
+{
+    for(int i=0; i<PBO_COUNT; i++)
+    {
+        pbos[i] = 0;
+    }
+}
+
+// Allocates an array texture in the streamer's format with a full mip chain for the given size,
+// without any contents
+GLuint TextureStreamer::createArrayTexture(int width, int height, int layers)
+{
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+
+    int levelCount = 0;
+    while(true)
+    {
+        if(format == TEXTURE_RGBA8)
+        {
+            glTexImage3D(GL_TEXTURE_2D_ARRAY, levelCount, GL_RGBA, width, height, layers, 0,
+                         GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        }
+        else
+        {
+            BCFormat bcFormat = (format == TEXTURE_BC1) ? BC1 : BC3;
+            GLsizei levelSize = (GLsizei)(bcEncodedSize(bcFormat, width, height) * layers);
+            glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, levelCount, compressedFormat, width, height, layers, 0,
+                                   levelSize, NULL);
+        }
+        levelCount++;
+        if(width == 1 && height == 1)
+        {
+            break;
+        }
+        width = (width > 1) ? width/2 : 1;
+        height = (height > 1) ? height/2 : 1;
+    }
+
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, levelCount - 1);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    return texture;
+}
+
+void TextureStreamer::init(const string& cacheDirectory, int layerWidth, int layerHeight,
+                           int layerCapacity, TextureFormat format, size_t bytesPerFrame)
+{
+    this->cacheDirectory = cacheDirectory;
+    this->bytesPerFrame = bytesPerFrame;
+
+    this->format = format;
+    if(format != TEXTURE_RGBA8 && !GLEW_EXT_texture_compression_s3tc)
+    {
+        cout << "S3TC texture compression not supported, using uncompressed textures" << endl;
+        this->format = TEXTURE_RGBA8;
+    }
+    compressedFormat = (this->format == TEXTURE_BC1) ? GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+                                                     : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+
+    // NOTE: A neutral grey so unlit/unloaded bodies are still visible while streaming
+    const unsigned char placeholderPixel[4] = {128, 128, 128, 255};
+    glGenTextures(1, &placeholder);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, placeholder);
+    gldebug::label(GL_TEXTURE, placeholder, "placeholder");
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA, 1, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, placeholderPixel);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    GLint maxLayers = 0;
+    glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+    layerCapacity = (layerCapacity > MAX_LAYERS) ? MAX_LAYERS : layerCapacity;
+    layerCapacity = (layerCapacity > maxLayers) ? maxLayers : layerCapacity;
+    this->layerWidth = layerWidth;
+    this->layerHeight = layerHeight;
+    this->layerCapacity = layerCapacity;
+    layersUsed = 0;
+    layerLabel.clear();
+    if(layerCapacity > 0)
+    {
+        layerArray = createArrayTexture(layerWidth, layerHeight, layerCapacity);
+    }
+
+    // Each PBO holds one frame's worth of uploads. Orphaning the buffer before every map lets the
+    // driver hand us fresh memory instead of waiting for the previous transfer to finish.
+    pboSize = bytesPerFrame;
+    glGenBuffers(PBO_COUNT, pbos);
+    for(int i=0; i<PBO_COUNT; i++)
+    {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbos[i]);
+        gldebug::label(GL_BUFFER, pbos[i], "texture upload");
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, pboSize, NULL, GL_STREAM_DRAW);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    stopping = false;
+    startTime = SDL_GetPerformanceCounter();
+}
+
+void TextureStreamer::shutdown()
+{
+    // NOTE: Loads that haven't started yet see stopping and return straight away, so this only
+    //       waits for the ones already decoding
+    stopping = true;
+    while(loadsInFlight.load() > 0)
+    {
+        this_thread::yield();
+    }
+
+    for(size_t i=0; i<requests.size(); i++)
+    {
+        if(!requests[i]->packed)
+        {
+            glDeleteTextures(1, &requests[i]->texture);
+        }
+    }
+    requests.clear();
+    glDeleteTextures(1, &layerArray);
+    glDeleteTextures(1, &placeholder);
+    glDeleteBuffers(PBO_COUNT, pbos);
+    layerArray = 0;
+    placeholder = 0;
+}
+
+int TextureStreamer::request(const string& filename)
+{
+    Request* request = new Request();
+    request->filename = filename;
+    request->texture = 0;
+    request->layer = 0;
+    request->packed = false;
+    request->state = QUEUED;
+
+    // NOTE: stbi_info only reads the image header, so deciding whether the texture can share the
+    //       layer array is cheap enough to do here rather than on a worker
+    int width, height, channelCount;
+    if(layersUsed < layerCapacity && stbi_info(filename.c_str(), &width, &height, &channelCount))
+    {
+        float scaleX = (float)width / layerWidth;
+        float scaleY = (float)height / layerHeight;
+        if(scaleX >= 0.5f && scaleX <= 2.0f && scaleY >= 0.5f && scaleY <= 2.0f)
+        {
+            request->packed = true;
+            request->texture = layerArray;
+            request->layer = layersUsed++;
+
+            layerLabel += layerLabel.empty() ? "layers: " : ", ";
+            layerLabel += textureLabel(filename);
+            gldebug::label(GL_TEXTURE, layerArray, layerLabel.c_str());
+        }
+    }
+    request->level = 0;
+    request->row = 0;
+    requests.push_back(unique_ptr<Request>(request));
+    pendingCount++;
+
+    loadsInFlight++;
+    jobsystem::runInBackground(jobsystem::createJob([this, request]
+    {
+        load(request);
+    }));
+
+    return (int)requests.size() - 1;
+}
+
+void TextureStreamer::load(Request* request)
+{
+    if(!stopping)
+    {
+        PROFILE_ZONE("load texture");
+        bool loaded;
+        if(request->packed)
+        {
+            loaded = request->image.load(request->filename, cacheDirectory, layerWidth, layerHeight, format);
+        }
+        else
+        {
+            loaded = request->image.load(request->filename, cacheDirectory, 0, 0, format);
+        }
+        request->state.store(loaded ? LOADED : FAILED, memory_order_release);
+    }
+    loadsInFlight--;
+}
+
+void TextureStreamer::update()
+{
+    if(pendingCount == 0)
+    {
+        return;
+    }
+    PROFILE_ZONE("texture uploads");
+
+    size_t budget = bytesPerFrame;
+    for(size_t i=0; i<requests.size() && budget > 0; i++)
+    {
+        Request* request = requests[i].get();
+        int state = request->state.load(memory_order_acquire);
+        if(state == LOADED)
+        {
+            // Packed textures go into the shared array allocated in init(). Anything else gets
+            // storage for its whole mip chain now, which is then filled in over the following
+            // frames.
+            if(!request->packed)
+            {
+                CookedTexture& image = request->image;
+                request->texture = createArrayTexture(image.width(), image.height(), 1);
+                gldebug::label(GL_TEXTURE, request->texture, textureLabel(request->filename).c_str());
+            }
+            request->state = UPLOADING;
+            state = UPLOADING;
+        }
+
+        if(state == UPLOADING)
+        {
+            if(uploadChunk(request, budget))
+            {
+                CookedTexture& image = request->image;
+                cachedCount += image.fromCache() ? 1 : 0;
+                size_t pixelCount = 0;
+                for(int level=0; level<image.levelCount(); level++)
+                {
+                    pixelCount += (size_t)image.width(level) * image.height(level);
+                }
+                gpuBytes += image.totalSize();
+                rgbaBytes += pixelCount * 4;
+                if(image.encodeMilliseconds() > 0.0)
+                {
+                    encodeMilliseconds += image.encodeMilliseconds();
+                    encodedPixels += pixelCount;
+                }
+                request->image.release();
+                request->state = RESIDENT;
+                pendingCount--;
+            }
+        }
+        else if(state == FAILED)
+        {
+            // NOTE: A failed texture keeps drawing with the placeholder (and its layer, if it had
+            //       one, is simply left unused)
+            cout << "Failed to load texture: " << request->filename << endl;
+            request->texture = 0;
+            request->state = RESIDENT;
+            pendingCount--;
+        }
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    if(pendingCount == 0)
+    {
+        double elapsedMs = 1000.0 * (SDL_GetPerformanceCounter() - startTime) / SDL_GetPerformanceFrequency();
+        cout << "Streamed " << requests.size() << " textures in " << elapsedMs << " ms ("
+             << cachedCount << " from texture cache)" << endl;
+        if(format != TEXTURE_RGBA8)
+        {
+            const double megabyte = 1024.0*1024.0;
+            cout << "Texture memory: " << gpuBytes/megabyte << " MB compressed, "
+                 << rgbaBytes/megabyte << " MB as RGBA8 (saved " << (rgbaBytes - gpuBytes)/megabyte << " MB)" << endl;
+            if(encodeMilliseconds > 0.0)
+            {
+                cout << "Block compression: " << encodedPixels/1e6 << " MPix in " << encodeMilliseconds
+                     << " ms (" << encodedPixels/1e3/encodeMilliseconds << " MPix/s)" << endl;
+            }
+        }
+    }
+}
+
+// Copies as many whole rows as fit in the remaining budget into the next PBO in the ring and
+// issues the transfer from there. Returns true once the last level has been uploaded.
+bool TextureStreamer::uploadChunk(Request* request, size_t& budget)
+{
+    CookedTexture& image = request->image;
+    glBindTexture(GL_TEXTURE_2D_ARRAY, request->texture);
+
+    // NOTE: Compressed data can only be addressed in whole blocks, so for those a "row" here is a
+    //       row of 4x4 blocks rather than a row of pixels
+    bool compressed = (image.format() != TEXTURE_RGBA8);
+    int rowHeight = compressed ? 4 : 1;
+
+    while(budget > 0 && request->level < image.levelCount())
+    {
+        int level = request->level;
+        int width = image.width(level);
+        int height = image.height(level);
+        int totalRows = (height + rowHeight - 1) / rowHeight;
+        size_t rowSize = image.levelSize(level) / totalRows;
+
+        // NOTE: Always move at least one row, otherwise a row larger than the budget would stall
+        //       the upload forever
+        int rowCount = (int)(budget / rowSize);
+        int maxRows = (int)(pboSize / rowSize);
+        rowCount = (rowCount < 1) ? 1 : rowCount;
+        rowCount = (maxRows >= 1 && rowCount > maxRows) ? maxRows : rowCount;
+        rowCount = (rowCount > totalRows - request->row) ? totalRows - request->row : rowCount;
+        size_t chunkSize = rowCount * rowSize;
+
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbos[nextPbo]);
+        nextPbo = (nextPbo + 1) % PBO_COUNT;
+        GLsizeiptr bufferSize = (chunkSize > pboSize) ? chunkSize : pboSize;
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, bufferSize, NULL, GL_STREAM_DRAW);
+        void* destination = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, chunkSize,
+                                             GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+        if(!destination)
+        {
+            return false;
+        }
+        memcpy(destination, image.levelData(level) + request->row * rowSize, chunkSize);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+        int y = request->row * rowHeight;
+        int pixelRows = (rowCount * rowHeight > height - y) ? height - y : rowCount * rowHeight;
+        if(compressed)
+        {
+            glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, y, request->layer, width, pixelRows, 1,
+                                      compressedFormat, (GLsizei)chunkSize, (void*)0);
+        }
+        else
+        {
+            glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, y, request->layer, width, pixelRows, 1,
+                            GL_RGBA, GL_UNSIGNED_BYTE, (void*)0);
+        }
+
+        budget = (chunkSize >= budget) ? 0 : budget - chunkSize;
+        request->row += rowCount;
+        if(request->row == totalRows)
+        {
+            request->level++;
+            request->row = 0;
+        }
+    }
+
+    return request->level == image.levelCount();
+}
+
+void TextureStreamer::binding(int handle, GLuint& texture, int& layer)
+{
+    Request* request = requests[handle].get();
+    if(request->state.load(memory_order_acquire) == RESIDENT && request->texture)
+    {
+        texture = request->texture;
+        layer = request->layer;
+        return;
+    }
+    texture = placeholder;
+    layer = 0;
+}
+
+bool TextureStreamer::isResident(int handle)
+{
+    return requests[handle]->state.load(memory_order_acquire) == RESIDENT;
+}
+
+bool TextureStreamer::busy()
+{
+    return pendingCount > 0;
+}
+
+size_t TextureStreamer::residentBytes()
+{
+    return gpuBytes;
+}
+
+size_t TextureStreamer::uncompressedBytes()
+{
+    return rgbaBytes;
+}
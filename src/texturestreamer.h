@@ -0,0 +1,118 @@
+#ifndef TEXTURE_STREAMER_H
+#define TEXTURE_STREAMER_H
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include <GL/glew.h>
+
+#include "texturecache.h"
+
+// Loads textures without blocking the render thread. Background jobs on the job system load/cook
+// the images through CookedTexture (which in turn spreads the filtering and encoding over the
+// other workers), and the GL thread then uploads them through a small ring of pixel buffer
+// objects, never moving more than a fixed number of bytes per frame. Until a texture is fully
+// resident binding() hands out a 1x1 placeholder, so callers can draw from the very first frame.
+//
+// Every texture is a GL_TEXTURE_2D_ARRAY. When layer packing is enabled (layerCapacity > 0 in
+// init()), textures are resampled to a common layer size and share a single array, so any number
+// of bodies can be drawn behind one bind by picking their layer in the shader. The array holds at
+// most min(layerCapacity, MAX_LAYERS, GL_MAX_ARRAY_TEXTURE_LAYERS) layers (GL 3.3 guarantees at
+// least 256). Textures that don't fit, or whose native size is more than a factor of 2 away from
+// the layer size on either axis (which would throw away or invent too much detail), fall back to
+// their own single-layer array at their native resolution.
+//
+// Textures can optionally be block compressed (BC1/BC3) when they are cooked. This needs
+// EXT_texture_compression_s3tc; without it the streamer quietly falls back to RGBA8.
+class TextureStreamer
+{
+public:
+    static const int MAX_LAYERS = 64;
+
+    TextureStreamer();
+
+    // Must be called with a current GL context. Packing is disabled when layerCapacity is 0.
+    void init(const std::string& cacheDirectory, int layerWidth, int layerHeight, int layerCapacity,
+              TextureFormat format=TEXTURE_RGBA8, size_t bytesPerFrame=8*1024*1024);
+    void shutdown();
+
+    // Queues a texture for loading and returns a handle for binding()
+    int request(const std::string& filename);
+
+    // Uploads at most bytesPerFrame worth of pending texture data. Call once per frame.
+    void update();
+
+    // The array texture and layer to sample for a handle: the real ones if the texture is
+    // resident, otherwise the placeholder
+    void binding(int handle, GLuint& texture, int& layer);
+    bool isResident(int handle);
+
+    // True while any requested texture is still loading or uploading
+    bool busy();
+
+    // GPU memory taken by resident textures, and what it would be as uncompressed RGBA8
+    size_t residentBytes();
+    size_t uncompressedBytes();
+
+private:
+    enum RequestState
+    {
+        QUEUED,
+        LOADED,
+        UPLOADING,
+        RESIDENT,
+        FAILED
+    };
+
+    struct Request
+    {
+        std::string filename;
+        CookedTexture image;
+        GLuint texture;
+        int layer;
+        bool packed;
+        std::atomic<int> state;
+        int level;
+        int row;
+    };
+
+    void load(Request* request);
+    bool uploadChunk(Request* request, size_t& budget);
+    GLuint createArrayTexture(int width, int height, int layers);
+
+    std::vector<std::unique_ptr<Request> > requests;
+    std::string cacheDirectory;
+    size_t bytesPerFrame;
+    GLuint placeholder;
+    TextureFormat format;
+    GLenum compressedFormat;
+
+    GLuint layerArray;
+    int layerWidth;
+    int layerHeight;
+    int layerCapacity;
+    int layersUsed;
+
+    // Names of the textures packed into layerArray, for debug output
+    std::string layerLabel;
+
+    static const int PBO_COUNT = 3;
+    GLuint pbos[PBO_COUNT];
+    size_t pboSize;
+    int nextPbo;
+
+    // Loads that were started and haven't returned yet, which shutdown() has to wait for
+    std::atomic<int> loadsInFlight;
+    std::atomic<bool> stopping;
+
+    int pendingCount;
+    int cachedCount;
+    size_t gpuBytes;
+    size_t rgbaBytes;
+    double encodeMilliseconds;
+    double encodedPixels;
+    uint64_t startTime;
+};
+
+#endif
@@ -0,0 +1,55 @@
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <atomic>
+
+// Hands the latest value from one writer thread to one reader thread without either ever
+// waiting on the other. There are three slots: the writer fills the back one, the reader reads
+// the front one, and the middle one holds the most recently published value. Publishing swaps
+// the back and middle slots and reading swaps the middle and front slots (only if something new
+// was published since), each with a single atomic exchange.
+//
+// The reader always gets a complete value, but not every value: if the writer publishes twice
+// before the reader looks, the first one is overwritten. Slots are reused, so the writer has to
+// fill in the whole value every time.
+template<typename T>
+class TripleBuffer
+{
+public:
+    TripleBuffer() : slots(), back(0), middle(1), front(2) {}
+
+    // Writer side: the slot to fill in, which publish() then makes the latest value
+    T& writeSlot()
+    {
+        return slots[back];
+    }
+
+    void publish()
+    {
+        back = middle.exchange(back | FRESH, std::memory_order_acq_rel) & INDEX_MASK;
+    }
+
+    // Reader side: the latest published value, which stays valid until the next call
+    const T& read()
+    {
+        if(middle.load(std::memory_order_relaxed) & FRESH)
+        {
+            front = middle.exchange(front, std::memory_order_acq_rel) & INDEX_MASK;
+        }
+        return slots[front];
+    }
+
+private:
+    static const unsigned int INDEX_MASK = 3;
+    static const unsigned int FRESH = 4;
+
+    T slots[3];
+
+    // NOTE: back is only touched by the writer and front only by the reader; they sit on their
+    //       own cache lines so that the two threads don't keep stealing each other's line
+    alignas(64) unsigned int back;
+    alignas(64) std::atomic<unsigned int> middle;
+    alignas(64) unsigned int front;
+};
+
+#endif
@@ -0,0 +1,309 @@
+#include <atomic>
+#include <chrono>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+#include "jobsystem.h"
+#include "spscqueue.h"
+#include "triplebuffer.h"
+
+using namespace std;
+
+// Stress tests for the lock-free building blocks: the triple buffer and SPSC queue that connect
+// the simulation thread to the main thread, and the job system's work-stealing deques and
+// sleep/wake protocol. Every test checks its results, and 'make stresstest' builds them with
+// ThreadSanitizer so that a data race fails the run even when the results happen to come out
+// right.
+//
+// Usage: stresstest [worker counts...], 0 1 3 by default (plus one per core, when that's more)
+
+// How long a test waits for work that should finish almost at once before calling it a hang
+static const double HANG_SECONDS = 30.0;
+
+static bool check(bool condition, const char* test, const char* what)
+{
+    if(!condition)
+    {
+        printf("FAIL %s: %s\n", test, what);
+    }
+    return condition;
+}
+
+static double secondsSince(chrono::steady_clock::time_point start)
+{
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+// A value big enough that a torn read (half of one publish, half of another) shows up
+struct Stamped
+{
+    uint64_t words[32];
+};
+
+static bool testTripleBuffer()
+{
+    const uint64_t publishes = 200000;
+    TripleBuffer<Stamped> buffer;
+    atomic<bool> done(false);
+
+    thread writer([&]()
+    {
+        for(uint64_t i=1; i<=publishes; i++)
+        {
+            Stamped& slot = buffer.writeSlot();
+            for(int word=0; word<32; word++)
+            {
+                slot.words[word] = i;
+            }
+            buffer.publish();
+        }
+        done.store(true);
+    });
+
+    // NOTE: Reads may skip values, but must never be torn or go back in time
+    uint64_t last = 0;
+    bool torn = false;
+    bool backwards = false;
+    while(!done.load())
+    {
+        const Stamped& value = buffer.read();
+        for(int word=1; word<32; word++)
+        {
+            torn = torn || (value.words[word] != value.words[0]);
+        }
+        backwards = backwards || (value.words[0] < last);
+        last = value.words[0];
+    }
+    writer.join();
+
+    return check(!torn, "triple buffer", "read a value that was only partly written") &&
+           check(!backwards, "triple buffer", "read an older value after a newer one") &&
+           check(buffer.read().words[0] == publishes, "triple buffer", "missed the last value");
+}
+
+static bool testSpscQueue()
+{
+    const uint64_t count = 1000000;
+    SpscQueue<uint64_t, 64> queue;
+
+    // NOTE: Both sides yield when they can't make progress, so the test also finishes on a
+    //       single core
+    thread producer([&]()
+    {
+        for(uint64_t i=0; i<count; i++)
+        {
+            while(!queue.push(i))
+            {
+                this_thread::yield();
+            }
+        }
+    });
+
+    bool ordered = true;
+    for(uint64_t i=0; i<count; i++)
+    {
+        uint64_t value;
+        while(!queue.pop(value))
+        {
+            this_thread::yield();
+        }
+        ordered = ordered && (value == i);
+    }
+    producer.join();
+
+    uint64_t extra;
+    return check(ordered, "spsc queue", "values came out lost, duplicated or out of order") &&
+           check(!queue.pop(extra), "spsc queue", "not empty after every value was taken");
+}
+
+// Every index of every range has to be visited exactly once, whatever the grain, including
+// grains that don't divide the count and tiny ones that make the deques split and steal a lot
+static bool testParallelFor()
+{
+    const size_t grains[] = {1, 7, 64, 1000};
+    for(size_t g=0; g<sizeof(grains)/sizeof(grains[0]); g++)
+    {
+        for(int round=0; round<20; round++)
+        {
+            size_t count = 10000 + round * 37;
+            vector<int> visits(count, 0);
+            jobsystem::parallelFor(count, grains[g], [&](size_t begin, size_t end)
+            {
+                for(size_t i=begin; i<end; i++)
+                {
+                    visits[i]++;
+                }
+            });
+            for(size_t i=0; i<count; i++)
+            {
+                if(!check(visits[i] == 1, "parallelFor", "an index was skipped or visited twice"))
+                {
+                    printf("  count %zu, grain %zu, index %zu visited %d times\n", count, grains[g], i, visits[i]);
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+// Jobs with children that themselves run parallelFor(), waited on through their common root
+static bool testNestedJobs()
+{
+    const int children = 64;
+    const uint64_t range = 1000;
+    atomic<uint64_t> sum(0);
+    atomic<uint64_t>* total = &sum;
+
+    jobsystem::Job* root = jobsystem::createJob([]() {});
+    for(int i=0; i<children; i++)
+    {
+        jobsystem::run(jobsystem::createJob([total]()
+        {
+            jobsystem::parallelFor(1000, 10, [total](size_t begin, size_t end)
+            {
+                for(size_t k=begin; k<end; k++)
+                {
+                    total->fetch_add(k);
+                }
+            });
+        }, root));
+    }
+    jobsystem::run(root);
+    jobsystem::wait(root);
+
+    // NOTE: Every child adds up 0..999
+    return check(jobsystem::finished(root), "nested jobs", "root not finished after wait()") &&
+           check(sum.load() == children * range * (range - 1) / 2, "nested jobs",
+                 "children ran the wrong number of times");
+}
+
+// Background jobs are only ever taken by workers, so a lost wake-up leaves them sitting in the
+// queue forever. Letting the workers go to sleep before every batch gives the sleep/wake
+// protocol plenty of chances to lose one.
+static bool testBackgroundJobs()
+{
+    const int batches = 50;
+    const int jobsPerBatch = 8;
+    for(int batch=0; batch<batches; batch++)
+    {
+        this_thread::sleep_for(chrono::milliseconds(1));
+
+        atomic<int> done(0);
+        atomic<int>* counter = &done;
+        for(int i=0; i<jobsPerBatch; i++)
+        {
+            jobsystem::runInBackground(jobsystem::createJob([counter]()
+            {
+                jobsystem::parallelFor(100, 5, [counter](size_t begin, size_t end)
+                {
+                    counter->fetch_add((int)(end - begin));
+                });
+            }));
+        }
+
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        while(done.load() < jobsPerBatch * 100 && secondsSince(start) < HANG_SECONDS)
+        {
+            this_thread::yield();
+        }
+        if(!check(done.load() == jobsPerBatch * 100, "background jobs", "jobs never ran (lost wake-up?)"))
+        {
+            printf("  batch %d: %d of %d items done\n", batch, done.load(), jobsPerBatch * 100);
+            return false;
+        }
+    }
+    return true;
+}
+
+// Threads that never called init() don't take part, so their jobs run on the spot
+static bool testOutsideThread()
+{
+    bool runsInline = false;
+    size_t visited = 0;
+    thread outsider([&]()
+    {
+        runsInline = !jobsystem::parallel();
+        jobsystem::parallelFor(1000, 10, [&](size_t begin, size_t end)
+        {
+            visited += end - begin;
+        });
+    });
+    outsider.join();
+
+    return check(runsInline, "outside thread", "a thread that didn't call init() counts as parallel") &&
+           check(visited == 1000, "outside thread", "parallelFor() missed part of the range");
+}
+
+static bool runJobTests(int workerCount)
+{
+    printf("Job system with %d workers:\n", workerCount);
+    jobsystem::init(workerCount);
+
+    struct
+    {
+        const char* name;
+        bool (*run)();
+    } tests[] =
+    {
+        {"parallelFor", testParallelFor},
+        {"nested jobs", testNestedJobs},
+        {"background jobs", testBackgroundJobs},
+        {"outside thread", testOutsideThread}
+    };
+
+    bool passed = true;
+    for(size_t i=0; i<sizeof(tests)/sizeof(tests[0]); i++)
+    {
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        bool ok = tests[i].run();
+        printf("  %-16s %s (%.2f s)\n", tests[i].name, ok ? "ok" : "FAILED", secondsSince(start));
+        passed = passed && ok;
+    }
+
+    jobsystem::shutdown();
+    return passed;
+}
+
+int main(int argc, char** argv)
+{
+    vector<int> workerCounts;
+    for(int i=1; i<argc; i++)
+    {
+        workerCounts.push_back(atoi(argv[i]));
+    }
+    if(workerCounts.empty())
+    {
+        workerCounts.push_back(0);
+        workerCounts.push_back(1);
+        workerCounts.push_back(3);
+        int cores = (int)thread::hardware_concurrency();
+        if(cores > 4)
+        {
+            workerCounts.push_back(cores - 1);
+        }
+    }
+
+    bool passed = true;
+    printf("Triple buffer:\n");
+    bool ok = testTripleBuffer();
+    printf("  %-16s %s\n", "publish/read", ok ? "ok" : "FAILED");
+    passed = passed && ok;
+
+    printf("SPSC queue:\n");
+    ok = testSpscQueue();
+    printf("  %-16s %s\n", "push/pop", ok ? "ok" : "FAILED");
+    passed = passed && ok;
+
+    for(size_t i=0; i<workerCounts.size(); i++)
+    {
+        passed = runJobTests(workerCounts[i]) && passed;
+    }
+
+    printf(passed ? "All stress tests passed\n" : "Some stress tests FAILED\n");
+    return passed ? 0 : 1;
+}